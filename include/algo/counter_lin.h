@@ -0,0 +1,75 @@
+#pragma once
+
+#include <algorithm>
+#include <utility>
+
+#include "fastlinutils.h"
+
+namespace fastlin {
+
+namespace counter {
+
+/**
+ * A counter starts at `0`. `fetch_add` increments it by one and returns the
+ * value before, so the `k` fetch_adds of a linearizable history return `0` to
+ * `k - 1` and are linearized in that order. A `read` of `v` must then fall
+ * between the fetch_adds returning `v - 1` and `v`, which only narrows their
+ * windows, leaving a greedy pass over the fetch_adds, O(n).
+ */
+
+// invocation or response, responses first at equal times as in `tune_events`
+using instant = std::pair<time_type, bool>;
+
+template <typename value_type>
+bool check(const history_t<value_type>& hist, bool with_reads) {
+  size_t adds = 0;
+  for (const auto& o : hist) adds += o.method == Method::FETCH_ADD;
+
+  // window of the fetch_add returning `v`
+  std::vector<instant> from(adds, {MIN_TIME, false});
+  std::vector<instant> to(adds, {MAX_TIME, false});
+  std::vector<bool> seen(adds, false);
+
+  progress.phase("counter", hist.size() + adds);
+  size_t processed = 0;
+  for (const auto& o : hist) {
+    if (!(++processed & 0xfff)) progress.update(processed);
+    if (o.value < 0) return false;
+    size_t v = o.value;
+    instant inv{o.startTime, true}, res{o.endTime, false};
+
+    if (o.method == Method::FETCH_ADD) {
+      if (v >= adds || seen[v]) return false;
+      seen[v] = true;
+      from[v] = std::max(from[v], inv);
+      to[v] = std::min(to[v], res);
+    } else if (o.method == Method::READ && with_reads) {
+      if (v > adds) return false;
+      if (v < adds) from[v] = std::max(from[v], inv);
+      if (v > 0) to[v - 1] = std::min(to[v - 1], res);
+    }
+  }
+
+  // earliest non-decreasing linearization points
+  instant point{MIN_TIME, false};
+  for (size_t v = 0; v < adds; ++v) {
+    if (!(++processed & 0xfff)) progress.update(processed);
+    point = std::max(point, from[v]);
+    if (to[v] < point) return false;
+  }
+  return true;
+}
+
+template <typename value_type>
+bool is_linearizable(history_t<value_type>& hist, const value_type&) {
+  return check(hist, true);
+}
+
+template <typename value_type>
+bool is_linearizable_x(history_t<value_type>& hist, const value_type&) {
+  return check(hist, false);
+}
+
+};  // namespace counter
+
+}  // namespace fastlin
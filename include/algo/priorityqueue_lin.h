@@ -1,6 +1,7 @@
 #pragma once
 
 #include <algorithm>
+#include <optional>
 
 #include "commons/segment_tree.h"
 #include "fastlinutils.h"
@@ -12,34 +13,27 @@ namespace priorityqueue {
 using add_methods = method_group<Method::INSERT>;
 using remove_methods = method_group<Method::POLL>;
 
-template <typename value_type>
-bool is_linearizable(history_t<value_type>& hist, const value_type& emptyVal) {
+// `hist` must be tuned and without empty operations, with times that fit
+// `index_type`
+template <typename value_type, typename index_type>
+bool check_tuned(history_t<value_type>& hist) {
   if (hist.empty()) return true;
 
-  if (!extend_dist_history<value_type, add_methods, remove_methods>(hist,
-                                                                    emptyVal))
-    return false;
-
-  events_t<value_type> events{get_events(hist)};
-  if (!tune_events<value_type, add_methods, remove_methods>(events, emptyVal,
-                                                            hist.back().id) ||
-      !verify_empty<value_type, add_methods, remove_methods>(events, emptyVal))
-    return false;
-
-  remove_empty(hist, events, emptyVal);
-
-  time_type maxTime =
-      std::get<0>(*std::ranges::max_element(events.begin(), events.end()));
-  segment_tree<value_type> segTree{maxTime};
-  std::sort(hist.begin(), hist.end(), [](const auto& a, const auto& b) {
+  progress.phase("build_trees");
+  time_type maxTime = max_end_time(hist);
+  segment_tree<value_type, index_type> segTree{maxTime};
+  sort_within_budget(hist, [](const auto& a, const auto& b) {
     return a.value > b.value || (a.value == b.value && a.id < b.id);
   });
 
-  value_type currVal = emptyVal;
+  std::optional<value_type> currVal;
   time_type minRes, maxInv;
+  progress.phase("priorityqueue", hist.size());
+  size_t processed = 0;
   for (const auto& op : hist) {
+    if (!(++processed & 0xfff)) progress.update(processed);
     if (currVal != op.value) {
-      if (currVal != emptyVal && minRes < maxInv)
+      if (currVal && minRes < maxInv)
         segTree.update_range(minRes, maxInv - 1, 1);
       currVal = op.value;
       minRes = op.endTime;
@@ -57,34 +51,26 @@ bool is_linearizable(history_t<value_type>& hist, const value_type& emptyVal) {
   return true;
 }
 
-template <typename value_type>
-bool is_linearizable_x(history_t<value_type>& hist,
-                       const value_type& emptyVal) {
+// `hist` must be tuned and without empty operations, with times that fit
+// `index_type`
+template <typename value_type, typename index_type>
+bool check_tuned_x(history_t<value_type>& hist) {
   if (hist.empty()) return true;
 
-  if (!extend_dist_history<value_type, add_methods, remove_methods>(hist,
-                                                                    emptyVal))
-    return false;
-
-  events_t<value_type> events{get_events(hist)};
-  if (!tune_events_x<value_type, add_methods>(events, emptyVal,
-                                              hist.back().id) ||
-      !verify_empty<value_type, add_methods, remove_methods>(events, emptyVal))
-    return false;
-
-  remove_empty(hist, events, emptyVal);
-
-  time_type maxTime =
-      std::get<0>(*std::ranges::max_element(events.begin(), events.end()));
-  segment_tree<value_type> segTree{maxTime};
-  std::sort(hist.begin(), hist.end(), [](const auto& a, const auto& b) {
+  progress.phase("build_trees");
+  time_type maxTime = max_end_time(hist);
+  segment_tree<value_type, index_type> segTree{maxTime};
+  sort_within_budget(hist, [](const auto& a, const auto& b) {
     return a.value > b.value ||
            // insert to be processed before poll
            (a.value == b.value && a.method == Method::INSERT);
   });
 
   time_type insertRes;
+  progress.phase("priorityqueue", hist.size());
+  size_t processed = 0;
   for (const auto& op : hist) {
+    if (!(++processed & 0xfff)) progress.update(processed);
     if (op.method == Method::INSERT)
       insertRes = op.endTime;
     else {
@@ -98,6 +84,49 @@ bool is_linearizable_x(history_t<value_type>& hist,
   return true;
 }
 
+template <typename value_type>
+bool is_linearizable(history_t<value_type>& hist, const value_type& emptyVal) {
+  if (hist.empty()) return true;
+
+  if (!extend_dist_history<value_type, add_methods, remove_methods>(hist,
+                                                                    emptyVal))
+    return false;
+
+  events_t<value_type> events{get_events(hist)};
+  if (!tune_events<value_type, add_methods, remove_methods>(events, emptyVal,
+                                                            hist.back().id) ||
+      !verify_empty<value_type, add_methods, remove_methods>(events, emptyVal))
+    return false;
+
+  remove_empty(hist, emptyVal);
+  reduce_history<value_type, add_methods, remove_methods>(hist);
+  return with_index_type(max_end_time(hist), [&](auto i) {
+    return check_segments(hist, check_tuned<value_type, decltype(i)>);
+  });
+}
+
+template <typename value_type>
+bool is_linearizable_x(history_t<value_type>& hist,
+                       const value_type& emptyVal) {
+  if (hist.empty()) return true;
+
+  if (!extend_dist_history<value_type, add_methods, remove_methods>(hist,
+                                                                    emptyVal))
+    return false;
+
+  events_t<value_type> events{get_events(hist)};
+  if (!tune_events_x<value_type, add_methods>(events, emptyVal,
+                                              hist.back().id) ||
+      !verify_empty<value_type, add_methods, remove_methods>(events, emptyVal))
+    return false;
+
+  remove_empty(hist, emptyVal);
+  reduce_history<value_type, add_methods, remove_methods>(hist);
+  return with_index_type(max_end_time(hist), [&](auto i) {
+    return check_segments(hist, check_tuned_x<value_type, decltype(i)>);
+  });
+}
+
 };  // namespace priorityqueue
 
-}  // namespace fastlin
\ No newline at end of file
+}  // namespace fastlin
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <algorithm>
+#include <optional>
 #include <ranges>
 #include <unordered_map>
 #include <vector>
@@ -15,30 +16,42 @@ using add_methods = method_group<Method::ENQ>;
 using remove_methods = method_group<Method::DEQ>;
 
 template <typename value_type>
-inline std::unordered_set<value_type> pendingVals;
+struct scan_state {
+  std::unordered_set<value_type> pendingVals;
+  std::unordered_set<value_type> ignoreVals;
+  std::vector<value_type> delayedVals;
+  std::unordered_map<value_type, size_t> cntByVal;
+};
+
+// per thread so that concurrent checks do not interfere, and kept across
+// checks so that their buckets stay allocated
 template <typename value_type>
-inline std::unordered_set<value_type> ignoreVals;
-template <typename value_type>
-inline std::vector<value_type> delayedVals;
-template <typename value_type>
-std::unordered_map<value_type, size_t> cntByVal;
+scan_state<value_type>& get_scan_state() {
+  thread_local scan_state<value_type> state;
+  return state;
+}
 
 template <typename value_type>
 void upgrade_val(const value_type& val) {
-  if (pendingVals<value_type>.erase(val))
-    ignoreVals<value_type>.insert(val);
+  auto& [pendingVals, ignoreVals, delayedVals, cntByVal] =
+      get_scan_state<value_type>();
+  if (pendingVals.erase(val))
+    ignoreVals.insert(val);
   else
-    pendingVals<value_type>.insert(val);
+    pendingVals.insert(val);
 }
 
 template <typename value_type, typename event_iter, Method method_arg>
 bool scan(event_iter& start, const event_iter& end) {
+  auto& [pendingVals, ignoreVals, delayedVals, cntByVal] =
+      get_scan_state<value_type>();
   event_iter temp = start;
   while (start != end) {
+    progress.check();
     const auto& [_, isInv, optr] = *start;
     const value_type& val = optr->value;
 
-    if (ignoreVals<value_type>.count(val) || optr->method != method_arg) {
+    if (ignoreVals.count(val) || optr->method != method_arg) {
       ++start;
       continue;
     }
@@ -53,27 +66,34 @@ bool scan(event_iter& start, const event_iter& end) {
 template <typename value_type, typename event_iter>
 bool scan_front(event_iter& start, const event_iter& end,
                 std::optional<value_type>& last) {
+  auto& [pendingVals, ignoreVals, delayedVals, cntByVal] =
+      get_scan_state<value_type>();
   event_iter temp = start;
+  // upgrading delayed values is progress too, even if it stops at the same
+  // response, as it may let the enqueue scan move on
+  bool upgraded = false;
   while (start != end) {
+    progress.check();
     const auto& [_, isInv, optr] = *start;
     const value_type& val = optr->value;
 
-    if (ignoreVals<value_type>.count(val) || optr->method == Method::ENQ) {
+    if (ignoreVals.count(val) || optr->method == Method::ENQ) {
       ++start;
       continue;
     }
 
-    if (last && ignoreVals<value_type>.count(*last)) last.reset();
+    if (last && ignoreVals.count(*last)) last.reset();
 
     if (!last) {
-      for (value_type& val : delayedVals<value_type>) upgrade_val(val);
-      delayedVals<value_type>.clear();
+      for (value_type& val : delayedVals) upgrade_val(val);
+      upgraded |= !delayedVals.empty();
+      delayedVals.clear();
     }
 
     if (isInv) {
       if (optr->method == Method::DEQ) {
         if (last && last != val)
-          delayedVals<value_type>.push_back(val);
+          delayedVals.push_back(val);
         else
           upgrade_val(val);
       }
@@ -86,76 +106,182 @@ bool scan_front(event_iter& start, const event_iter& end,
     ++start;
     continue;
   }
-  return temp != start;
+  return temp != start || upgraded;
 }
 
+// `hist` must be tuned and without empty operations
 template <typename value_type>
-bool is_linearizable(history_t<value_type>& hist, const value_type& emptyVal) {
-  if (hist.empty()) return true;
-
-  if (!extend_dist_history<value_type, add_methods, remove_methods>(hist,
-                                                                    emptyVal))
-    return false;
+bool check_tuned(history_t<value_type>& hist) {
+  auto& [pendingVals, ignoreVals, delayedVals, cntByVal] =
+      get_scan_state<value_type>();
 
   events_t<value_type> events{get_events(hist)};
-  if (!tune_events<value_type, add_methods, remove_methods>(events, emptyVal,
-                                                            hist.back().id) ||
-      !verify_empty<value_type, add_methods, remove_methods>(events, emptyVal))
-    return false;
-
-  remove_empty(hist, events, emptyVal);
+  sort_events(events);
 
-  std::sort(events.begin(), events.end());
-
-  cntByVal<value_type>.clear();
-  for (const auto& o : hist) ++cntByVal<value_type>[o.value];
+  cntByVal.clear();
+  for (const auto& o : hist) ++cntByVal[o.value];
 
   // initializations
   std::optional<value_type> lastFront;
-  pendingVals<value_type>.clear();
-  ignoreVals<value_type>.clear();
-  delayedVals<value_type>.clear();
+  pendingVals.clear();
+  ignoreVals.clear();
+  delayedVals.clear();
   auto enqStart = events.begin();
   auto frontStart = events.begin();
   auto end = events.end();
 
+  progress.phase("queue", events.size());
   while (
       scan<value_type, decltype(enqStart), Method::ENQ>(enqStart, end) ||
-      scan_front<value_type, decltype(frontStart)>(frontStart, end, lastFront));
+      scan_front<value_type, decltype(frontStart)>(frontStart, end, lastFront))
+    progress.update(std::min(enqStart, frontStart) - events.begin());
 
   return enqStart == end && frontStart == end;
 }
 
+// `hist` must be tuned and without empty operations
 template <typename value_type>
-bool is_linearizable_x(history_t<value_type>& hist,
-                       const value_type& emptyVal) {
+bool check_tuned_x(history_t<value_type>& hist) {
+  auto& [pendingVals, ignoreVals, delayedVals, cntByVal] =
+      get_scan_state<value_type>();
+
+  events_t<value_type> events{get_events(hist)};
+  sort_events(events);
+
+  // initializations
+  pendingVals.clear();
+  ignoreVals.clear();
+  auto enqStart = events.begin();
+  auto deqStart = events.begin();
+  const auto end = events.end();
+
+  progress.phase("queue", events.size());
+  while (scan<value_type, decltype(enqStart), Method::ENQ>(enqStart, end) ||
+         scan<value_type, decltype(deqStart), Method::DEQ>(deqStart, end))
+    progress.update(std::min(enqStart, deqStart) - events.begin());
+
+  return enqStart == end && deqStart == end;
+}
+
+/**
+ * Single producer or single consumer histories, where no two enqueues, or no
+ * two dequeues other than the last `appended` ones extending the history,
+ * overlap. Their order is then that of the linearization, leaving a greedy
+ * pass:
+ * - enqueues of `v_1, v_2, ...` in order: the dequeue of `v_i` must respond
+ *   after the enqueue of `v_i` and the dequeues of `v_1` to `v_i` are invoked
+ * - dequeues of `w_1, w_2, ...` in order: the enqueue of `w_j` and the dequeue
+ *   of `w_j` must respond after the enqueues of `w_1` to `w_j` are invoked,
+ *   and so must the enqueues of values never dequeued after all of them
+ * Returns nullopt for other shapes. `hist` must be tuned and without empty
+ * operations, O(n) expected.
+ */
+template <typename value_type>
+std::optional<bool> check_ordered(const history_t<value_type>& hist,
+                                  size_t appended) {
+  if (hist.empty()) return std::nullopt;
+  for (const auto& o : hist)
+    if (o.method == Method::PEEK) return std::nullopt;
+
+  // operations of `method` by invocation if none of them overlap, times being
+  // distinct once tuned
+  size_t real = hist.size() - appended;
+  time_type maxTime = max_end_time(hist);
+  spill_vector<size_t> at;
+  std::vector<size_t> order;
+  auto ordered = [&](Method method) {
+    at.assign(maxTime + 1, hist.size());
+    for (size_t i = 0; i < real; ++i) {
+      if (hist[i].method != method) continue;
+      if (at[hist[i].startTime] != hist.size()) return false;
+      at[hist[i].startTime] = i;
+    }
+    order.clear();
+    for (time_type t = 0; t <= maxTime; ++t) {
+      if (at[t] == hist.size()) continue;
+      if (!order.empty() && hist[order.back()].endTime >= t) return false;
+      order.push_back(at[t]);
+    }
+    return true;
+  };
+
+  progress.phase("queue_ordered", hist.size());
+  std::unordered_map<value_type, size_t> other;
+  if (ordered(Method::ENQ)) {
+    for (size_t i = 0; i < hist.size(); ++i)
+      if (hist[i].method == Method::DEQ) other.emplace(hist[i].value, i);
+    time_type maxDeqStart = MIN_TIME;
+    for (size_t e : order) {
+      const auto& deq = hist[other[hist[e].value]];
+      maxDeqStart = std::max(maxDeqStart, deq.startTime);
+      if (deq.endTime <= hist[e].startTime || deq.endTime <= maxDeqStart)
+        return false;
+    }
+    return true;
+  }
+
+  if (ordered(Method::DEQ)) {
+    for (size_t i = 0; i < hist.size(); ++i)
+      if (hist[i].method == Method::ENQ) other.emplace(hist[i].value, i);
+    time_type maxEnqStart = MIN_TIME;
+    for (size_t d : order) {
+      const auto& enq = hist[other[hist[d].value]];
+      maxEnqStart = std::max(maxEnqStart, enq.startTime);
+      if (enq.endTime <= maxEnqStart || hist[d].endTime <= maxEnqStart)
+        return false;
+    }
+    for (size_t i = real; i < hist.size(); ++i)
+      if (hist[other[hist[i].value]].endTime <= maxEnqStart) return false;
+    return true;
+  }
+  return std::nullopt;
+}
+
+template <typename value_type>
+bool is_linearizable(history_t<value_type>& hist, const value_type& emptyVal) {
   if (hist.empty()) return true;
 
+  size_t unextended = hist.size();
   if (!extend_dist_history<value_type, add_methods, remove_methods>(hist,
                                                                     emptyVal))
     return false;
+  size_t appended = hist.size() - unextended;
 
   events_t<value_type> events{get_events(hist)};
-  if (!tune_events_x<value_type, add_methods>(events, emptyVal,
-                                              hist.back().id) ||
+  if (!tune_events<value_type, add_methods, remove_methods>(events, emptyVal,
+                                                            hist.back().id) ||
       !verify_empty<value_type, add_methods, remove_methods>(events, emptyVal))
     return false;
 
-  remove_empty(hist, events, emptyVal);
+  remove_empty(hist, emptyVal);
+  // only empty operations were removed, leaving the extension at the end
+  if (auto verdict = check_ordered(hist, appended)) return *verdict;
+  reduce_history<value_type, add_methods, remove_methods>(hist);
+  return check_segments(hist, check_tuned<value_type>);
+}
 
-  std::sort(events.begin(), events.end());
+template <typename value_type>
+bool is_linearizable_x(history_t<value_type>& hist,
+                       const value_type& emptyVal) {
+  if (hist.empty()) return true;
 
-  // initializations
-  pendingVals<value_type>.clear();
-  ignoreVals<value_type>.clear();
-  auto enqStart = events.begin();
-  auto deqStart = events.begin();
-  const auto end = events.end();
+  size_t unextended = hist.size();
+  if (!extend_dist_history<value_type, add_methods, remove_methods>(hist,
+                                                                    emptyVal))
+    return false;
+  size_t appended = hist.size() - unextended;
 
-  while (scan<value_type, decltype(enqStart), Method::ENQ>(enqStart, end) ||
-         scan<value_type, decltype(deqStart), Method::DEQ>(deqStart, end));
+  events_t<value_type> events{get_events(hist)};
+  if (!tune_events_x<value_type, add_methods>(events, emptyVal,
+                                              hist.back().id) ||
+      !verify_empty<value_type, add_methods, remove_methods>(events, emptyVal))
+    return false;
 
-  return enqStart == end && deqStart == end;
+  remove_empty(hist, emptyVal);
+  // only empty operations were removed, leaving the extension at the end
+  if (auto verdict = check_ordered(hist, appended)) return *verdict;
+  reduce_history<value_type, add_methods, remove_methods>(hist);
+  return check_segments(hist, check_tuned_x<value_type>);
 }
 
 };  // namespace queue
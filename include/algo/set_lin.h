@@ -1,7 +1,10 @@
 #pragma once
 
+#include <atomic>
+#include <type_traits>
 #include <unordered_map>
 
+#include "commons/parallel.h"
 #include "fastlinutils.h"
 
 namespace fastlin {
@@ -11,56 +14,110 @@ namespace set {
 using add_methods = method_group<Method::INSERT>;
 using remove_methods = method_group<Method::REMOVE>;
 
-template <typename value_type>
-bool is_linearizable(history_t<value_type>& hist, const value_type& emptyVal) {
+// operations grouped by value into contiguous columns, the `g`-th distinct
+// value owning indices `offsets[g]` to `offsets[g + 1] - 1`
+struct value_columns {
+  std::vector<size_t> offsets;
+  std::vector<Method> methods;
+  std::vector<time_type> starts;
+  std::vector<time_type> ends;
+};
+
+// one hash lookup per operation followed by a counting sort on the group
+template <typename history_type>
+value_columns group_by_value(const history_type& hist) {
+  using value_type = std::decay_t<decltype(value_at(hist, 0))>;
+  std::unordered_map<value_type, size_t> groupOf;
+  std::vector<size_t> group(hist.size());
+  for (size_t i = 0; i < hist.size(); ++i)
+    group[i] =
+        groupOf.try_emplace(value_at(hist, i), groupOf.size()).first->second;
+
+  value_columns cols;
+  cols.offsets.assign(groupOf.size() + 1, 0);
+  for (size_t g : group) ++cols.offsets[g + 1];
+  for (size_t g = 1; g < cols.offsets.size(); ++g)
+    cols.offsets[g] += cols.offsets[g - 1];
+
+  cols.methods.resize(hist.size());
+  cols.starts.resize(hist.size());
+  cols.ends.resize(hist.size());
+  std::vector<size_t> cursor(cols.offsets.begin(), cols.offsets.end() - 1);
+  for (size_t i = 0; i < hist.size(); ++i) {
+    size_t pos = cursor[group[i]]++;
+    cols.methods[pos] = method_at(hist, i);
+    cols.starts[pos] = start_at(hist, i);
+    cols.ends[pos] = end_at(hist, i);
+  }
+  return cols;
+}
+
+// checks groups across `thread_count` workers, all of them stopping as soon
+// as any one finds a violation
+template <typename group_check>
+bool check_groups(const value_columns& cols, group_check check) {
+  std::atomic<bool> violated{false};
+  parallel_for(
+      cols.offsets.size() - 1,
+      [&](size_t begin, size_t end) {
+        for (size_t g = begin;
+             g < end && !violated.load(std::memory_order_relaxed); ++g)
+          if (!check(cols.offsets[g], cols.offsets[g + 1]))
+            violated.store(true, std::memory_order_relaxed);
+      },
+      1 << 10);
+  return !violated;
+}
+
+template <typename value_type, typename history_type = history_t<value_type>>
+bool is_linearizable(history_type& hist, const value_type& emptyVal) {
   if (hist.empty()) return true;
 
   if (!extend_dist_history<value_type, add_methods, remove_methods>(hist,
                                                                     emptyVal))
     return false;
 
-  std::unordered_map<value_type, std::pair<time_type, time_type>> minResMaxInv;
-  for (const auto& o : hist)
-    if (o.method != Method::CONTAINS_FALSE) {
-      auto& elem =
-          minResMaxInv.try_emplace(o.value, MAX_TIME, MIN_TIME).first->second;
-      elem.first = std::min(elem.first, o.endTime);
-      elem.second = std::max(elem.second, o.startTime);
+  const value_columns cols = group_by_value(hist);
+  return check_groups(cols, [&cols](size_t b, size_t e) {
+    // branch-free reductions so that they vectorize
+    time_type minRes = MAX_TIME, maxInv = MIN_TIME;
+    for (size_t i = b; i < e; ++i) {
+      bool present = cols.methods[i] != Method::CONTAINS_FALSE;
+      minRes = std::min(minRes, present ? cols.ends[i] : MAX_TIME);
+      maxInv = std::max(maxInv, present ? cols.starts[i] : MIN_TIME);
     }
 
-  for (const auto& o : hist) {
-    auto& elem = minResMaxInv.at(o.value);
-    if (o.method != Method::CONTAINS_FALSE) {
-      if (o.method == INSERT && o.startTime > elem.first) return false;
-      if (o.method == REMOVE && o.endTime < elem.second) return false;
-    } else if (elem.first < o.startTime && o.endTime < elem.second)
-      return false;
-  }
-
-  return true;
+    for (size_t i = b; i < e; ++i) {
+      const Method& method = cols.methods[i];
+      if (method == INSERT && cols.starts[i] > minRes) return false;
+      if (method == REMOVE && cols.ends[i] < maxInv) return false;
+      if (method == CONTAINS_FALSE && minRes < cols.starts[i] &&
+          cols.ends[i] < maxInv)
+        return false;
+    }
+    return true;
+  });
 }
 
-template <typename value_type>
-bool is_linearizable_x(history_t<value_type>& hist,
-                       const value_type& emptyVal) {
+template <typename value_type, typename history_type = history_t<value_type>>
+bool is_linearizable_x(history_type& hist, const value_type& emptyVal) {
   if (hist.empty()) return true;
 
   if (!extend_dist_history<value_type, add_methods, remove_methods>(hist,
                                                                     emptyVal))
     return false;
 
-  std::unordered_map<value_type, time_type> minRes;
-  for (const auto& o : hist) {
-    auto& elem = minRes.try_emplace(o.value, MAX_TIME).first->second;
-    elem = std::min(elem, o.endTime);
-  }
-
-  for (const auto& o : hist)
-    if (o.method == INSERT && o.startTime > minRes.at(o.value)) return false;
+  const value_columns cols = group_by_value(hist);
+  return check_groups(cols, [&cols](size_t b, size_t e) {
+    time_type minRes = MAX_TIME;
+    for (size_t i = b; i < e; ++i) minRes = std::min(minRes, cols.ends[i]);
 
-  return true;
+    for (size_t i = b; i < e; ++i)
+      if (cols.methods[i] == INSERT && cols.starts[i] > minRes) return false;
+    return true;
+  });
 }
 
 };  // namespace set
 
-}  // namespace fastlin
\ No newline at end of file
+}  // namespace fastlin
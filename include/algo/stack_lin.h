@@ -20,10 +20,11 @@ using remove_methods = method_group<Method::POP>;
 constexpr int PERM_MULTI_LAYERS = -1;
 constexpr int PERM_INF_LAYERS = -2;
 
-template <typename value_type>
+// `index_type` as chosen by `with_index_type` for the largest time
+template <typename value_type, typename index_type>
 struct stack_perm_segtree {
-  typedef int pos_t;
-  typedef std::pair<int, value_type> node_value_t;
+  typedef index_type pos_t;
+  typedef std::pair<index_type, value_type> node_value_t;
 
   struct stack_segment_tree_node_zero {
     static constexpr node_value_t value{{}, {}};
@@ -40,18 +41,18 @@ struct stack_perm_segtree {
   struct stack_segment_tree_point_remover {
     inline void operator()(node_value_t& v) {
       // we are only removing values anyways
-      v.first = std::numeric_limits<int>::max();
+      v.first = std::numeric_limits<index_type>::max();
     }
   };
 
-  typedef segment_tree<node_value_t, stack_segment_tree_node_zero,
+  typedef segment_tree<node_value_t, index_type, stack_segment_tree_node_zero,
                        stack_segment_tree_node_updater,
                        stack_segment_tree_point_remover>
       segtree_t;
 
   stack_perm_segtree(const history_t<value_type>& hist, size_t n) : n{n} {
-    std::vector<node_value_t> initializer(n << 1,
-                                          stack_segment_tree_node_zero::value);
+    spill_vector<node_value_t> initializer(n << 1,
+                                            stack_segment_tree_node_zero::value);
     for (const operation_t<value_type>& o : hist) {
       if (o.method == PUSH)
         critIntervals[o.value].start = o.endTime;
@@ -64,8 +65,10 @@ struct stack_perm_segtree {
         initializer[intvl.end] = {-1, -value};
       }
     node_value_t prefixSum = stack_segment_tree_node_zero::value;
-    for (node_value_t& pr : initializer)
+    for (node_value_t& pr : initializer) {
       pr = stack_segment_tree_node_updater()(prefixSum, pr);
+      maxLayers = std::max(maxLayers, pr.first);
+    }
     segTree = std::make_unique<segtree_t>(initializer, (n << 1) - 1);
   }
 
@@ -94,58 +97,59 @@ struct stack_perm_segtree {
             std::nullopt};
   }
 
+  // largest number of critical intervals covering any single time
+  index_type max_layers() const { return maxLayers; }
+
  private:
   std::unordered_map<value_type, std::vector<time_type>> waitingReturns;
   std::vector<time_type> pendingReturns;
   std::unique_ptr<segtree_t> segTree;
   size_t n;
-  std::unordered_map<value_type, interval> critIntervals;
+  index_type maxLayers = 0;
+  std::unordered_map<value_type, interval<index_type>> critIntervals;
 };
 
-template <typename value_type>
-bool is_linearizable(history_t<value_type>& hist, const value_type& emptyVal) {
+// `hist` must be tuned and without empty operations, with times that fit
+// `index_type`
+template <typename value_type, typename index_type>
+bool check_tuned(history_t<value_type>& hist) {
   if (hist.empty()) return true;
 
-  if (!extend_dist_history<value_type, add_methods, remove_methods>(hist,
-                                                                    emptyVal))
-    return false;
-
-  events_t<value_type> events{get_events(hist)};
-  if (!tune_events<value_type, add_methods, remove_methods>(events, emptyVal,
-                                                            hist.back().id) ||
-      !verify_empty<value_type, add_methods, remove_methods>(events, emptyVal))
-    return false;
-
-  time_type maxTime =
-      std::get<0>(*std::ranges::max_element(events.begin(), events.end()));
-  remove_empty(hist, emptyVal);
+  progress.phase("build_trees");
+  time_type maxTime = max_end_time(hist);
 
-  auto mem_alloc =
-      std::make_shared<memory_allocator<interval_tree_node>>(hist.size() << 1);
+  auto mem_alloc = std::make_shared<
+      memory_allocator<interval_tree_node<index_type>>>(hist.size() << 1);
   interval_tree<decltype(mem_alloc)> ops{mem_alloc};
   std::unordered_map<value_type, interval_tree<decltype(mem_alloc)>> opByVal;
-  std::vector<value_type> startTimeToVal(maxTime + 1);
-  stack_perm_segtree<value_type> sst{hist, static_cast<size_t>(maxTime)};
+  spill_vector<value_type> startTimeToVal(maxTime + 1);
+  stack_perm_segtree<value_type, index_type> sst{hist,
+                                                 static_cast<size_t>(maxTime)};
 
   for (const auto& o : hist) {
-    interval itr{static_cast<int>(o.startTime), static_cast<int>(o.endTime)};
+    interval<index_type> itr{static_cast<index_type>(o.startTime),
+                             static_cast<index_type>(o.endTime)};
     ops.insert(itr);
     startTimeToVal[o.startTime] = o.value;
     auto [map_iter, _] = opByVal.try_emplace(o.value, mem_alloc);
     map_iter->second.insert(itr);
   }
 
+  progress.phase("stack", hist.size());
+  size_t removed = 0;
   while (!ops.empty()) {
+    progress.update(removed);
     auto [pos, optVal] = sst.get_permissive();
     if (pos == PERM_MULTI_LAYERS) return false;
     if (pos == PERM_INF_LAYERS) return true;
 
-    std::vector<interval> overlaps =
+    std::vector<interval<index_type>> overlaps =
         optVal ? opByVal.at(*optVal).query(pos) : ops.query(pos);
-    for (const interval& itr : overlaps) {
+    for (const interval<index_type>& itr : overlaps) {
       value_type val = startTimeToVal[itr.start];
       opByVal.at(val).remove(itr);
       ops.remove(itr);
+      ++removed;
       if (opByVal.at(val).empty()) sst.remove_subhistory(val);
     }
   }
@@ -153,49 +157,45 @@ bool is_linearizable(history_t<value_type>& hist, const value_type& emptyVal) {
   return true;
 }
 
-template <typename value_type>
-bool is_linearizable_x(history_t<value_type>& hist,
-                       const value_type& emptyVal) {
+// `hist` must be tuned and without empty operations, with times that fit
+// `index_type`
+template <typename value_type, typename index_type>
+bool check_tuned_x(history_t<value_type>& hist) {
   if (hist.empty()) return true;
 
-  if (!extend_dist_history<value_type, add_methods, remove_methods>(hist,
-                                                                    emptyVal))
-    return false;
-
-  events_t<value_type> events{get_events(hist)};
-  if (!tune_events_x<value_type, add_methods>(events, emptyVal,
-                                              hist.back().id) ||
-      !verify_empty<value_type, add_methods, remove_methods>(events, emptyVal))
-    return false;
-
-  time_type maxTime =
-      std::get<0>(*std::ranges::max_element(events.begin(), events.end()));
-  remove_empty(hist, emptyVal);
+  progress.phase("build_trees");
+  time_type maxTime = max_end_time(hist);
 
   auto mem_alloc =
-      std::make_shared<memory_allocator<interval_tree_node>>(hist.size());
-  std::vector<value_type> startTimeToVal(maxTime + 1);
-  stack_perm_segtree<value_type> sst{hist, static_cast<size_t>(maxTime)};
+      std::make_shared<memory_allocator<interval_tree_node<index_type>>>(
+          hist.size());
+  spill_vector<value_type> startTimeToVal(maxTime + 1);
+  stack_perm_segtree<value_type, index_type> sst{hist,
+                                                 static_cast<size_t>(maxTime)};
 
-  std::vector<interval> intervals;
+  std::vector<interval<index_type>> intervals;
   intervals.reserve(hist.size());
   for (const auto& o : hist) {
-    intervals.emplace_back(static_cast<int>(o.startTime),
-                           static_cast<int>(o.endTime));
+    intervals.emplace_back(static_cast<index_type>(o.startTime),
+                           static_cast<index_type>(o.endTime));
     startTimeToVal[o.startTime] = o.value;
   }
   interval_tree ops{mem_alloc, std::move(intervals)};
 
   std::unordered_set<value_type> pending;
+  progress.phase("stack", hist.size());
+  size_t removed = 0;
   while (!ops.empty()) {
+    progress.update(removed);
     auto [pos, optVal] = sst.get_permissive();
     if (pos == PERM_MULTI_LAYERS) return false;
     if (pos == PERM_INF_LAYERS) return true;
 
     if (optVal) continue;
 
-    for (const interval& itr : ops.query(pos)) {
+    for (const interval<index_type>& itr : ops.query(pos)) {
       ops.remove(itr);
+      ++removed;
       value_type val = startTimeToVal[itr.start];
       if (!pending.insert(val).second) sst.remove_subhistory(val);
     }
@@ -204,6 +204,76 @@ bool is_linearizable_x(history_t<value_type>& hist,
   return true;
 }
 
+template <typename value_type>
+bool is_linearizable(history_t<value_type>& hist, const value_type& emptyVal) {
+  if (hist.empty()) return true;
+
+  if (!extend_dist_history<value_type, add_methods, remove_methods>(hist,
+                                                                    emptyVal))
+    return false;
+
+  events_t<value_type> events{get_events(hist)};
+  if (!tune_events<value_type, add_methods, remove_methods>(events, emptyVal,
+                                                            hist.back().id) ||
+      !verify_empty<value_type, add_methods, remove_methods>(events, emptyVal))
+    return false;
+
+  remove_empty(hist, emptyVal);
+  reduce_history<value_type, add_methods, remove_methods>(hist);
+  return with_index_type(max_end_time(hist), [&](auto i) {
+    return check_segments(hist, check_tuned<value_type, decltype(i)>);
+  });
+}
+
+template <typename value_type>
+bool is_linearizable_x(history_t<value_type>& hist,
+                       const value_type& emptyVal) {
+  if (hist.empty()) return true;
+
+  if (!extend_dist_history<value_type, add_methods, remove_methods>(hist,
+                                                                    emptyVal))
+    return false;
+
+  events_t<value_type> events{get_events(hist)};
+  if (!tune_events_x<value_type, add_methods>(events, emptyVal,
+                                              hist.back().id) ||
+      !verify_empty<value_type, add_methods, remove_methods>(events, emptyVal))
+    return false;
+
+  remove_empty(hist, emptyVal);
+  reduce_history<value_type, add_methods, remove_methods>(hist);
+  return with_index_type(max_end_time(hist), [&](auto i) {
+    return check_segments(hist, check_tuned_x<value_type, decltype(i)>);
+  });
+}
+
+// Maximum nesting depth of critical intervals over the preprocessed history,
+// or nullopt if preprocessing alone already rejects it
+template <typename value_type>
+std::optional<size_t> max_critical_nesting(history_t<value_type> hist,
+                                        const value_type& emptyVal) {
+  if (hist.empty()) return 0;
+
+  if (!extend_dist_history<value_type, add_methods, remove_methods>(hist,
+                                                                    emptyVal))
+    return std::nullopt;
+
+  events_t<value_type> events{get_events(hist)};
+  if (!tune_events<value_type, add_methods, remove_methods>(events, emptyVal,
+                                                            hist.back().id) ||
+      !verify_empty<value_type, add_methods, remove_methods>(events, emptyVal))
+    return std::nullopt;
+
+  time_type maxTime =
+      std::get<0>(*std::ranges::max_element(events.begin(), events.end()));
+  remove_empty(hist, emptyVal);
+  return with_index_type(maxTime, [&](auto i) -> size_t {
+    return stack_perm_segtree<value_type, decltype(i)>{
+        hist, static_cast<size_t>(maxTime)}
+        .max_layers();
+  });
+}
+
 };  // namespace stack
 
 }  // namespace fastlin
\ No newline at end of file
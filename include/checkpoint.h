@@ -0,0 +1,298 @@
+#pragma once
+
+#include <algorithm>
+#include <fstream>
+#include <numeric>
+#include <unordered_map>
+#include <unordered_set>
+
+#include "algo/priorityqueue_lin.h"
+#include "algo/queue_lin.h"
+#include "algo/set_lin.h"
+#include "algo/stack_lin.h"
+#include "history_reader.h"
+
+namespace fastlin {
+
+/**
+ * Incremental checking of an append-only history file. Only the rows appended
+ * since the last call are read, and the verdict equals that of a full run over
+ * every newline-terminated row read so far.
+ *
+ * - `set` keeps the per-value reductions of `set::is_linearizable`
+ * - other types keep the operations after the latest cut, i.e. a time before
+ *   which every operation responded and every value was both added and
+ *   removed, together with the verdict of the closed part before it
+ */
+template <typename value_type>
+struct checkpoint {
+ public:
+  typedef bool (*monitor_t)(history_t<value_type>&, const value_type&);
+
+  checkpoint(const std::string& type, bool exclude_peeks)
+      : type(type), exclude_peeks(exclude_peeks) {}
+
+  // Restores state saved by `save`, returns false (leaving a fresh state) if
+  // the file is missing or was written for another data type or flags
+  bool load(const std::string& path) {
+    std::ifstream f(path);
+    std::string magic, fileType;
+    bool fileXpeeks;
+    if (!(f >> magic >> fileType >> fileXpeeks) || magic != MAGIC ||
+        fileType != type || fileXpeeks != exclude_peeks)
+      return false;
+
+    size_t cnt;
+    f >> offset >> lastId >> maxTime >> closedOk >> hasCut >> cut >> cnt;
+    for (size_t i = 0; i < cnt; ++i) {
+      value_type v;
+      set_summary s;
+      size_t absentCnt;
+      f >> v >> s.adds >> s.removes >> s.maxAddInv >> s.minRemoveRes >>
+          s.minRes >> s.maxInv >> s.minResAll >> absentCnt;
+      s.absent.resize(absentCnt);
+      for (auto& [st, en] : s.absent) f >> st >> en;
+      summaries.emplace(v, std::move(s));
+    }
+    f >> cnt;
+    for (size_t i = 0; i < cnt; ++i) {
+      value_type v;
+      f >> v;
+      closedVals.insert(v);
+    }
+    f >> cnt;
+    for (size_t i = 0; i < cnt; ++i) {
+      operation_t<value_type> o;
+      int method;
+      f >> o.id >> method >> o.value >> o.startTime >> o.endTime;
+      o.method = static_cast<Method>(method);
+      retained.push_back(o);
+    }
+    if (!f) {
+      *this = checkpoint(type, exclude_peeks);
+      return false;
+    }
+    return true;
+  }
+
+  void save(const std::string& path) const {
+    std::ofstream f(path);
+    f << MAGIC << " " << type << " " << exclude_peeks << "\n"
+      << offset << " " << lastId << " " << maxTime << " " << closedOk << " "
+      << hasCut << " " << cut << "\n";
+    f << summaries.size() << "\n";
+    for (const auto& [v, s] : summaries) {
+      f << v << " " << s.adds << " " << s.removes << " " << s.maxAddInv << " "
+        << s.minRemoveRes << " " << s.minRes << " " << s.maxInv << " "
+        << s.minResAll << " " << s.absent.size();
+      for (const auto& [st, en] : s.absent) f << " " << st << " " << en;
+      f << "\n";
+    }
+    f << closedVals.size() << "\n";
+    for (const value_type& v : closedVals) f << v << "\n";
+    f << retained.size() << "\n";
+    for (const auto& o : retained)
+      f << o.id << " " << static_cast<int>(o.method) << " " << o.value << " "
+        << o.startTime << " " << o.endTime << "\n";
+  }
+
+  // Folds in the rows appended to the file of `reader` and returns the
+  // verdict of the whole file
+  bool advance(history_reader<value_type>& reader, const value_type& emptyVal,
+               monitor_t monitor) {
+    // the file was truncated or replaced
+    if (!reader.resumable(offset)) *this = checkpoint(type, exclude_peeks);
+    history_t<value_type> suffix = read_appended(reader);
+
+    if (type == "set") return advance_set(suffix, emptyVal);
+#define SUPPORT_DS(TYPE)                                                    \
+  if (type == #TYPE) {                                                      \
+    if (!advance_cut<TYPE::add_methods, TYPE::remove_methods>(              \
+            suffix, emptyVal, monitor)) {                                   \
+      *this = checkpoint(type, exclude_peeks);                              \
+      advance_cut<TYPE::add_methods, TYPE::remove_methods>(                 \
+          read_appended(reader), emptyVal, monitor);                        \
+    }                                                                       \
+    return verdict;                                                         \
+  }
+    SUPPORT_DS(stack);
+    SUPPORT_DS(queue);
+    SUPPORT_DS(priorityqueue);
+#undef SUPPORT_DS
+    throw std::invalid_argument("Unknown data type");
+  }
+
+  size_t operations() const { return lastId; }
+
+ private:
+  static constexpr const char* MAGIC = "fastlin-checkpoint-1";
+
+  history_t<value_type> read_appended(history_reader<value_type>& reader) {
+    history_t<value_type> suffix = reader.get_appended(offset, lastId);
+    if (!suffix.empty()) lastId = suffix.back().id;
+    return suffix;
+  }
+
+  // checks a copy with ids renumbered from 1, as the engines size per-id
+  // tables by the largest id
+  static bool check(history_t<value_type> hist, const value_type& emptyVal,
+                    monitor_t monitor) {
+    id_type id = 0;
+    for (auto& o : hist) o.id = ++id;
+    return monitor(hist, emptyVal);
+  }
+
+  struct set_summary {
+    int adds = 0;
+    int removes = 0;
+    time_type maxAddInv = MIN_TIME;
+    time_type minRemoveRes = MAX_TIME;
+    // over all but contains_false operations
+    time_type minRes = MAX_TIME;
+    time_type maxInv = MIN_TIME;
+    // over all operations, for `set::is_linearizable_x`
+    time_type minResAll = MAX_TIME;
+    // contains_false intervals not dominated by a later starting and earlier
+    // responding one
+    std::vector<std::pair<time_type, time_type>> absent;
+  };
+
+  bool advance_set(const history_t<value_type>& suffix,
+                   const value_type& emptyVal) {
+    for (const auto& o : suffix) {
+      set_summary& s = summaries[o.value];
+      if (o.value != emptyVal) maxTime = std::max(maxTime, o.endTime);
+      s.minResAll = std::min(s.minResAll, o.endTime);
+      if (o.method == Method::CONTAINS_FALSE) {
+        add_absent(s.absent, o.startTime, o.endTime);
+        continue;
+      }
+      s.minRes = std::min(s.minRes, o.endTime);
+      s.maxInv = std::max(s.maxInv, o.startTime);
+      if (set::add_methods::contains(o.method)) {
+        ++s.adds;
+        s.maxAddInv = std::max(s.maxAddInv, o.startTime);
+      } else if (set::remove_methods::contains(o.method)) {
+        ++s.removes;
+        s.minRemoveRes = std::min(s.minRemoveRes, o.endTime);
+      }
+    }
+
+    // mirrors `extend_dist_history` followed by the set checks
+    for (const auto& [v, s] : summaries) {
+      time_type minRes = exclude_peeks ? s.minResAll : s.minRes;
+      time_type maxInv = s.maxInv;
+      time_type minRemoveRes = s.minRemoveRes;
+      if (v != emptyVal) {
+        if (s.adds != 1 || s.removes > 1) return false;
+        if (!s.removes) {
+          minRes = std::min(minRes, maxTime + 2);
+          maxInv = std::max(maxInv, maxTime + 1);
+          minRemoveRes = maxTime + 2;
+        }
+      }
+      if (s.adds && s.maxAddInv > minRes) return false;
+      if (exclude_peeks) continue;
+      if (minRemoveRes < maxInv) return false;
+      for (const auto& [st, en] : s.absent)
+        if (minRes < st && en < maxInv) return false;
+    }
+    return true;
+  }
+
+  static void add_absent(std::vector<std::pair<time_type, time_type>>& absent,
+                         time_type st, time_type en) {
+    for (const auto& [s, e] : absent)
+      if (s >= st && e <= en) return;
+    std::erase_if(absent, [&](const auto& pr) {
+      return st >= pr.first && en <= pr.second;
+    });
+    absent.emplace_back(st, en);
+  }
+
+  // returns false if an appended operation starts before the cut, in which
+  // case the whole file has to be checked again
+  template <typename add_group, typename remove_group>
+  bool advance_cut(const history_t<value_type>& suffix,
+                   const value_type& emptyVal, monitor_t monitor) {
+    for (const auto& o : suffix) {
+      if (hasCut && o.startTime <= cut) return false;
+      if (o.value != emptyVal && closedVals.count(o.value)) closedOk = false;
+    }
+    retained.insert(retained.end(), suffix.begin(), suffix.end());
+
+    // latest cut: a prefix by invocation in which every value is complete and
+    // every operation responds before the next invocation
+    struct value_data {
+      size_t total = 0;
+      size_t seen = 0;
+      bool hasAdd = false;
+      bool hasRemove = false;
+    };
+    std::unordered_map<value_type, value_data> byVal;
+    for (const auto& o : retained) {
+      if (o.value == emptyVal) continue;
+      value_data& d = byVal[o.value];
+      ++d.total;
+      d.hasAdd |= add_group::contains(o.method);
+      d.hasRemove |= remove_group::contains(o.method);
+    }
+
+    std::vector<size_t> order(retained.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+      return retained[a].startTime < retained[b].startTime;
+    });
+
+    size_t openVals = 0, cutPos = 0;
+    time_type maxEnd = MIN_TIME, cutTime = MIN_TIME;
+    for (size_t i = 0; i < order.size(); ++i) {
+      const auto& o = retained[order[i]];
+      maxEnd = std::max(maxEnd, o.endTime);
+      if (o.value != emptyVal) {
+        value_data& d = byVal[o.value];
+        if (!d.seen++) ++openVals;
+        if (d.seen == d.total && d.hasAdd && d.hasRemove) --openVals;
+      }
+      if (!openVals &&
+          (i + 1 == order.size() || maxEnd < retained[order[i + 1]].startTime))
+        cutPos = i + 1, cutTime = maxEnd;
+    }
+
+    if (cutPos) {
+      history_t<value_type> closed, rest;
+      std::vector<bool> isClosed(retained.size(), false);
+      for (size_t i = 0; i < cutPos; ++i) isClosed[order[i]] = true;
+      for (size_t i = 0; i < retained.size(); ++i)
+        (isClosed[i] ? closed : rest).push_back(retained[i]);
+      for (const auto& o : closed)
+        if (o.value != emptyVal) closedVals.insert(o.value);
+      closedOk = closedOk && check(std::move(closed), emptyVal, monitor);
+      retained = std::move(rest);
+      hasCut = true;
+      cut = cutTime;
+    }
+
+    verdict = closedOk && check(retained, emptyVal, monitor);
+    return true;
+  }
+
+  std::string type;
+  bool exclude_peeks;
+  std::streamoff offset = 0;
+  id_type lastId = 0;
+  bool verdict = true;
+
+  // set
+  time_type maxTime = MIN_TIME;
+  std::unordered_map<value_type, set_summary> summaries;
+
+  // stack, queue and priorityqueue
+  bool closedOk = true;
+  bool hasCut = false;
+  time_type cut = MIN_TIME;
+  std::unordered_set<value_type> closedVals;
+  history_t<value_type> retained;
+};
+
+}  // namespace fastlin
@@ -1,7 +1,7 @@
 #pragma once
 
-#include <stdint.h>
-
+#include <algorithm>
+#include <limits>
 #include <memory>
 #include <type_traits>
 #include <vector>
@@ -10,32 +10,49 @@
 
 namespace fastlin {
 
+// `index_type` is a signed integer wide enough for every endpoint
+template <typename index_type = int>
 struct interval {
-  int start;
-  int end;
+  index_type start;
+  index_type end;
 };
 
+template <typename index_type = int>
 struct interval_tree_node {
-  interval intvl;
-  int maxEnd;
+  interval<index_type> intvl;
+  index_type maxEnd;
   int height;
   interval_tree_node* left;
   interval_tree_node* right;
 
-  interval_tree_node(interval i)
+  interval_tree_node(interval<index_type> i)
       : intvl(i), maxEnd(i.end), height(1), left(nullptr), right(nullptr) {}
 };
 
+template <typename allocator>
+struct interval_tree_index {};
+
+template <typename index_type>
+struct interval_tree_index<memory_allocator<interval_tree_node<index_type>>> {
+  using type = index_type;
+};
+
 template <typename T>
-concept memory_allocator_ptr =
-    std::is_same_v<typename std::pointer_traits<std::decay_t<T>>::element_type,
-                   memory_allocator<interval_tree_node>>;
+concept memory_allocator_ptr = requires {
+  typename interval_tree_index<
+      typename std::pointer_traits<std::decay_t<T>>::element_type>::type;
+};
 
 // interval tree efficient O(log n) insert/delete of intervals and `O(m log n)`
-// point query
+// point query, indexed as the nodes `ptr_t` allocates
 template <memory_allocator_ptr ptr_t>
 struct interval_tree {
  public:
+  using index_type = typename interval_tree_index<
+      typename std::pointer_traits<ptr_t>::element_type>::type;
+  using interval = fastlin::interval<index_type>;
+  using interval_tree_node = fastlin::interval_tree_node<index_type>;
+
   interval_tree(ptr_t ptr) : mem_alloc_ptr(ptr), root(nullptr) {}
 
   interval_tree(ptr_t ptr, std::vector<interval>&& v) : mem_alloc_ptr(ptr) {
@@ -53,7 +70,7 @@ struct interval_tree {
 
   // Retrieves all intervals overlapping `point`. `O(m log n)` time complexity,
   // where `m` is the size of output and `n` is the size of tree
-  std::vector<interval> query(int point) {
+  std::vector<interval> query(index_type point) {
     std::vector<interval> result;
     query(root, point, result);
     return result;
@@ -79,7 +96,9 @@ struct interval_tree {
 
   int height(interval_tree_node* n) { return n ? n->height : 0; }
 
-  int maxEnd(interval_tree_node* n) { return n ? n->maxEnd : INT32_MIN; }
+  index_type maxEnd(interval_tree_node* n) {
+    return n ? n->maxEnd : std::numeric_limits<index_type>::min();
+  }
 
   int getBalance(interval_tree_node* n) {
     return n ? height(n->left) - height(n->right) : 0;
@@ -181,7 +200,7 @@ struct interval_tree {
     return autoBalance(node);
   }
 
-  void query(interval_tree_node* node, int point,
+  void query(interval_tree_node* node, index_type point,
              std::vector<interval>& result) {
     if (!node) return;
 
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace fastlin {
+
+// number of worker threads used by parallel passes, `1` runs them inline
+inline unsigned int thread_count =
+    std::max(1u, std::thread::hardware_concurrency());
+
+// whether the calling thread runs a chunk of a parallel pass, whose nested
+// passes then run inline rather than multiplying the threads
+inline thread_local bool in_parallel = false;
+
+// Runs `f(begin, end)` over contiguous chunks of `[0, n)`, one per worker.
+// Fewer than `grain` indices per worker are not worth a thread, and passes
+// nested in another run inline. The first exception thrown by a worker is
+// rethrown once all of them have joined.
+template <typename F>
+void parallel_for(size_t n, F&& f, size_t grain = 1 << 14) {
+  size_t workers = std::min<size_t>(thread_count, (n + grain - 1) / grain);
+  if (workers <= 1 || in_parallel) {
+    f(size_t{0}, n);
+    return;
+  }
+
+  std::exception_ptr error;
+  std::mutex errorMtx;
+  auto run = [&](size_t b, size_t e) {
+    bool outer = in_parallel;
+    in_parallel = true;
+    try {
+      f(b, e);
+    } catch (...) {
+      std::lock_guard lock{errorMtx};
+      if (!error) error = std::current_exception();
+    }
+    in_parallel = outer;
+  };
+
+  size_t chunk = (n + workers - 1) / workers;
+  std::vector<std::thread> pool;
+  pool.reserve(workers - 1);
+  for (size_t w = 1; w < workers; ++w)
+    pool.emplace_back(run, std::min(n, w * chunk),
+                      std::min(n, (w + 1) * chunk));
+  run(0, chunk);
+  for (std::thread& t : pool) t.join();
+  if (error) std::rethrow_exception(error);
+}
+
+// Runs `f(i)` for every `i` in `[0, n)`, workers taking the next index as soon
+// as they are done with the last, for items of uneven cost
+template <typename F>
+void parallel_for_each(size_t n, F&& f) {
+  std::atomic<size_t> next{0};
+  parallel_for(
+      std::min<size_t>(n, thread_count),
+      [&](size_t, size_t) {
+        for (size_t i; (i = next.fetch_add(1, std::memory_order_relaxed)) < n;)
+          f(i);
+      },
+      1);
+}
+
+}  // namespace fastlin
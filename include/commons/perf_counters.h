@@ -0,0 +1,121 @@
+#pragma once
+
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <iomanip>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace fastlin {
+
+/**
+ * Hardware counters of the process, including threads it starts afterwards,
+ * attributed to the phase reported to `progress` while they ticked. Phases
+ * running concurrently on several threads are attributed to the one entered
+ * last. Counters the kernel or hardware does not offer are left out.
+ */
+struct perf_counters {
+ public:
+  static constexpr size_t COUNT = 5;
+
+  ~perf_counters() {
+    for (int fd : fds)
+      if (fd >= 0) close(fd);
+  }
+
+  // returns whether any counter could be opened
+  bool open() {
+    const std::pair<uint32_t, uint64_t> events[COUNT]{
+        {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+        {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+        {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES},
+        {PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+        {PERF_TYPE_HW_CACHE,
+         PERF_COUNT_HW_CACHE_DTLB | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+             (PERF_COUNT_HW_CACHE_RESULT_MISS << 16)}};
+
+    bool any = false;
+    for (size_t i = 0; i < COUNT; ++i) {
+      perf_event_attr attr;
+      std::memset(&attr, 0, sizeof(attr));
+      attr.size = sizeof(attr);
+      attr.type = events[i].first;
+      attr.config = events[i].second;
+      attr.inherit = 1;
+      attr.exclude_kernel = 1;
+      attr.exclude_hv = 1;
+      fds[i] = syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+      any = any || fds[i] >= 0;
+    }
+    return any;
+  }
+
+  // attributes the counts since the last call to the phase left
+  void enter(const char* phase) {
+    std::lock_guard lock{mtx};
+    std::array<uint64_t, COUNT> now = read_all();
+    if (current) {
+      auto& totals = phase_totals(current);
+      for (size_t i = 0; i < COUNT; ++i) totals[i] += now[i] - last[i];
+    }
+    last = now;
+    current = phase;
+  }
+
+  // one line per phase, in the order first entered, with misses per operation
+  void print(std::ostream& out, size_t operations) {
+    enter("idle");
+    std::lock_guard lock{mtx};
+    static const char* names[COUNT]{"cycles", "instructions", "llc_misses",
+                                    "branch_misses", "dtlb_misses"};
+    double ops = std::max<size_t>(operations, 1);
+    out << std::fixed << std::setprecision(3);
+    for (const auto& [phase, totals] : phases) {
+      out << "perf " << phase;
+      for (size_t i = 0; i < 2; ++i)
+        if (fds[i] >= 0) out << " " << names[i] << " " << totals[i];
+      if (fds[0] >= 0 && fds[1] >= 0)
+        out << " ipc "
+            << (totals[0] ? static_cast<double>(totals[1]) / totals[0] : 0.0);
+      for (size_t i = 2; i < COUNT; ++i)
+        if (fds[i] >= 0) out << " " << names[i] << "/op " << totals[i] / ops;
+      out << "\n";
+    }
+    out << std::defaultfloat;
+  }
+
+ private:
+  std::array<uint64_t, COUNT> read_all() const {
+    std::array<uint64_t, COUNT> values{};
+    for (size_t i = 0; i < COUNT; ++i)
+      if (fds[i] < 0 ||
+          ::read(fds[i], &values[i], sizeof(uint64_t)) != sizeof(uint64_t))
+        values[i] = 0;
+    return values;
+  }
+
+  std::array<uint64_t, COUNT>& phase_totals(const std::string& phase) {
+    for (auto& [name, totals] : phases)
+      if (name == phase) return totals;
+    return phases.emplace_back(phase, std::array<uint64_t, COUNT>{}).second;
+  }
+
+  int fds[COUNT]{-1, -1, -1, -1, -1};
+  std::mutex mtx;
+  const char* current = nullptr;
+  std::array<uint64_t, COUNT> last{};
+  std::vector<std::pair<std::string, std::array<uint64_t, COUNT>>> phases;
+};
+
+inline perf_counters phase_counters;
+
+}  // namespace fastlin
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <atomic>
+#include <stdexcept>
+#include <string>
+
+namespace fastlin {
+
+// thrown from within the engines once a cancellation has been requested
+struct cancelled_error : std::runtime_error {
+  cancelled_error() : std::runtime_error("check cancelled") {}
+};
+
+// Engines report the phase they are in and how far along it they are, and
+// poll for cooperative cancellation from their main loops. Another thread
+// may read the status or request cancellation at any time.
+struct progress_token {
+ public:
+  // `total` of `0` means the amount of work is not known upfront
+  void phase(const char* name, size_t total = 0) {
+    if (auto f = observer.load(std::memory_order_relaxed)) f(name);
+    phaseTotal.store(total, std::memory_order_relaxed);
+    phaseDone.store(0, std::memory_order_relaxed);
+    phaseName.store(name, std::memory_order_relaxed);
+    check();
+  }
+
+  // `done` items of the current phase have been processed
+  void update(size_t done) {
+    phaseDone.store(done, std::memory_order_relaxed);
+    check();
+  }
+
+  void check() const {
+    if (cancelRequested.load(std::memory_order_relaxed))
+      throw cancelled_error();
+  }
+
+  // `f` is called with the name of every phase entered, from the thread
+  // entering it
+  void observe(void (*f)(const char* name)) {
+    observer.store(f, std::memory_order_relaxed);
+  }
+
+  void cancel() { cancelRequested.store(true, std::memory_order_relaxed); }
+
+  void reset() {
+    cancelRequested.store(false, std::memory_order_relaxed);
+    phase("idle");
+  }
+
+  // e.g. `tune_events 42%`
+  std::string status() const {
+    std::string s = phaseName.load(std::memory_order_relaxed);
+    size_t total = phaseTotal.load(std::memory_order_relaxed);
+    if (total)
+      s += " " +
+           std::to_string(phaseDone.load(std::memory_order_relaxed) * 100 /
+                          total) +
+           "%";
+    return s;
+  }
+
+ private:
+  std::atomic<const char*> phaseName{"idle"};
+  std::atomic<size_t> phaseDone{0};
+  std::atomic<size_t> phaseTotal{0};
+  std::atomic<bool> cancelRequested{false};
+  std::atomic<void (*)(const char*)> observer{nullptr};
+};
+
+inline progress_token progress;
+
+}  // namespace fastlin
@@ -1,7 +1,10 @@
 #pragma once
 
+#include <limits>
 #include <vector>
 
+#include "spill_alloc.h"
+
 namespace fastlin {
 
 // `O(log n)` range update
@@ -26,7 +29,8 @@ struct default_segment_tree_updater {
   inline void operator()(value_type& a, const value_type& b) { a += b; }
 };
 
-template <typename value_type,
+// `index_type` is a signed integer numbering the up to `4 * size` nodes
+template <typename value_type, typename index_type = int,
           typename zero_allocator = default_segment_tree_zero<value_type>,
           typename updater = default_segment_tree_updater<value_type>,
           typename remover = default_segment_tree_point_remover<value_type>>
@@ -42,17 +46,18 @@ struct segment_tree {
     build(1, 0, size - 1, arr);
   }
 
-  void update_range(int l, int r, value_type addend) {
+  void update_range(index_type l, index_type r, value_type addend) {
     update_range(1, 0, size - 1, l, r, addend);
   }
 
-  void remove_point(int pnt) { remove_point(1, 0, size - 1, pnt); }
+  void remove_point(index_type pnt) { remove_point(1, 0, size - 1, pnt); }
 
-  std::pair<value_type, int> query_min() {
+  std::pair<value_type, index_type> query_min() {
     return {tree[1].min_value, tree[1].min_pos};
   }
 
-  std::pair<value_type, int> query_min_range(int l, int r) {
+  std::pair<value_type, index_type> query_min_range(index_type l,
+                                                    index_type r) {
     return query_min_range(1, 0, size - 1, l, r);
   }
 
@@ -60,32 +65,33 @@ struct segment_tree {
   struct segment_tree_node {
     value_type min_value;
     value_type weight;
-    int min_pos;
+    index_type min_pos;
   };
 
-  void build(int v, int tl, int tr) {
+  void build(index_type v, index_type tl, index_type tr) {
     tree[v] = {zero_allocator::value, zero_allocator::value, tl};
     if (tl != tr) {
-      int tm = (tl + tr) >> 1;
+      index_type tm = (tl + tr) >> 1;
       build(v << 1, tl, tm);
       build((v << 1) + 1, tm + 1, tr);
     }
   }
 
   template <typename value_ptr>
-  void build(int v, int tl, int tr, const value_ptr& arr) {
+  void build(index_type v, index_type tl, index_type tr,
+             const value_ptr& arr) {
     if (tl == tr) {
       tree[v] = {arr[tl], arr[tl], tl};
     } else {
-      int tm = (tl + tr) >> 1;
+      index_type tm = (tl + tr) >> 1;
       build(v << 1, tl, tm, arr);
       build((v << 1) + 1, tm + 1, tr, arr);
       update_node(v);
     }
   }
 
-  void update_node(int par) {
-    int left = par << 1;
+  void update_node(index_type par) {
+    index_type left = par << 1;
     auto take = (tree[left].min_value <= tree[left + 1].min_value)
                     ? tree[left]
                     : tree[left + 1];
@@ -93,7 +99,7 @@ struct segment_tree {
     tree[par].min_pos = take.min_pos;
   }
 
-  void propagate(int v) {
+  void propagate(index_type v) {
     auto& node = tree[v];
     if (node.weight == zero_allocator::value) return;
     apply(v << 1, node.weight);
@@ -101,32 +107,34 @@ struct segment_tree {
     node.weight = zero_allocator::value;
   }
 
-  void apply(int v, value_type addend) {
+  void apply(index_type v, value_type addend) {
     updater()(tree[v].min_value, addend);
     updater()(tree[v].weight, addend);
   }
 
-  void remove(int v) { remover()(tree[v].min_value); }
+  void remove(index_type v) { remover()(tree[v].min_value); }
 
-  void update_range(int v, int tl, int tr, int l, int r, value_type addend) {
+  void update_range(index_type v, index_type tl, index_type tr, index_type l,
+                    index_type r, value_type addend) {
     if (l <= tl && tr <= r) {
       apply(v, addend);
       return;
     }
     propagate(v);
-    int tm = (tl + tr) >> 1;
+    index_type tm = (tl + tr) >> 1;
     if (l <= tm) update_range(v << 1, tl, tm, l, r, addend);
     if (tm < r) update_range((v << 1) + 1, tm + 1, tr, l, r, addend);
     update_node(v);
   }
 
-  void remove_point(int v, int tl, int tr, int p) {
+  void remove_point(index_type v, index_type tl, index_type tr,
+                    index_type p) {
     if (tl == tr) {
       remove(v);
       return;
     }
     propagate(v);
-    int tm = (tl + tr) >> 1;
+    index_type tm = (tl + tr) >> 1;
     if (p <= tm)
       remove_point(v << 1, tl, tm, p);
     else
@@ -134,12 +142,15 @@ struct segment_tree {
     update_node(v);
   }
 
-  std::pair<value_type, int> query_min_range(int v, int tl, int tr, int l,
-                                             int r) {
+  std::pair<value_type, index_type> query_min_range(index_type v,
+                                                    index_type tl,
+                                                    index_type tr,
+                                                    index_type l,
+                                                    index_type r) {
     if (l > r) return {std::numeric_limits<int>::max(), -1};
     if (l == tl && r == tr) return {tree[v].min_value, tree[v].min_pos};
     propagate(v);
-    int tm = (tl + tr) >> 1;
+    index_type tm = (tl + tr) >> 1;
     auto left_res = query_min_range(v << 1, tl, tm, l, std::min(r, tm));
     auto right_res =
         query_min_range((v << 1) + 1, tm + 1, tr, std::max(l, tm + 1), r);
@@ -148,8 +159,8 @@ struct segment_tree {
 
   // root at `1`, left child at `2*par`, right child at `2*par+1`
   // for odd size ranges, mid belongs to right child
-  std::vector<segment_tree_node> tree;
-  int size;
+  spill_vector<segment_tree_node> tree;
+  index_type size;
 };
 
 }  // namespace fastlin
\ No newline at end of file
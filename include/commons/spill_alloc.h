@@ -0,0 +1,135 @@
+#pragma once
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <functional>
+#include <memory>
+#include <new>
+#include <queue>
+#include <string>
+#include <vector>
+
+#include "parallel.h"
+
+namespace fastlin {
+
+// Bytes the large arrays of a check should stay within, `0` meaning no limit.
+// Must be set before the first check, as it decides how arrays are freed.
+inline size_t memory_budget = 0;
+
+// arrays at least this large are spilled to disk
+inline size_t spill_threshold() {
+  return memory_budget ? std::max<size_t>(memory_budget >> 3, 1 << 12)
+                       : SIZE_MAX;
+}
+
+// Maps an unlinked file of `bytes` under `$TMPDIR` (default `/tmp`), which
+// should be on local disk rather than tmpfs
+inline void* map_spill_file(size_t bytes) {
+  const char* dir = std::getenv("TMPDIR");
+  std::string path =
+      std::string(dir && *dir ? dir : "/tmp") + "/fastlin-XXXXXX";
+  int fd = mkstemp(path.data());
+  if (fd < 0) throw std::bad_alloc();
+  unlink(path.c_str());
+
+  void* ptr = MAP_FAILED;
+  if (!ftruncate(fd, bytes))
+    ptr = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  close(fd);
+  if (ptr == MAP_FAILED) throw std::bad_alloc();
+  return ptr;
+}
+
+// Allocates arrays from `spill_threshold()` bytes up in files mapped into
+// memory, so that under memory pressure the kernel writes their pages back
+// to disk and evicts them instead of the process being killed
+template <typename T>
+struct spill_allocator {
+  using value_type = T;
+
+  spill_allocator() = default;
+  template <typename U>
+  spill_allocator(const spill_allocator<U>&) {}
+
+  T* allocate(size_t n) {
+    if (n * sizeof(T) < spill_threshold())
+      return std::allocator<T>{}.allocate(n);
+    return static_cast<T*>(map_spill_file(n * sizeof(T)));
+  }
+
+  void deallocate(T* ptr, size_t n) {
+    if (n * sizeof(T) < spill_threshold())
+      std::allocator<T>{}.deallocate(ptr, n);
+    else
+      munmap(ptr, n * sizeof(T));
+  }
+
+  template <typename U>
+  bool operator==(const spill_allocator<U>&) const {
+    return true;
+  }
+};
+
+template <typename T>
+using spill_vector = std::vector<T, spill_allocator<T>>;
+
+// Merges the sorted runs of `v` starting at each of `runs` with a heap of
+// their heads, O(n log k)
+template <typename T, typename alloc, typename compare = std::less<>>
+void merge_runs(std::vector<T, alloc>& v, const std::vector<size_t>& runs,
+                compare comp = {}) {
+  // next and end of each run
+  using cursor = std::pair<size_t, size_t>;
+  auto later = [&](const cursor& a, const cursor& b) {
+    return comp(v[b.first], v[a.first]);
+  };
+  std::priority_queue<cursor, std::vector<cursor>, decltype(later)> heads{
+      later};
+  for (size_t i = 0; i < runs.size(); ++i)
+    heads.emplace(runs[i], i + 1 < runs.size() ? runs[i + 1] : v.size());
+
+  std::vector<T, alloc> merged;
+  merged.reserve(v.size());
+  while (!heads.empty()) {
+    auto [next, end] = heads.top();
+    heads.pop();
+    merged.push_back(std::move(v[next]));
+    if (++next < end) heads.emplace(next, end);
+  }
+  v.swap(merged);
+}
+
+// arrays shorter than this are sorted by a single thread
+inline size_t parallel_sort_min = 1 << 16;
+
+// Sorts `v` in runs of a quarter of the budget and k-way merges them, so that
+// spilled arrays are mostly accessed sequentially. Large arrays are also cut
+// into a run per worker, sorted concurrently.
+template <typename T, typename alloc, typename compare = std::less<>>
+void sort_within_budget(std::vector<T, alloc>& v, compare comp = {}) {
+  size_t run = memory_budget
+                   ? std::max<size_t>((memory_budget >> 2) / sizeof(T), 1)
+                   : v.size();
+  if (thread_count > 1 && v.size() >= parallel_sort_min)
+    run = std::min(run, (v.size() + thread_count - 1) / thread_count);
+  if (v.size() <= run) {
+    std::sort(v.begin(), v.end(), comp);
+    return;
+  }
+
+  std::vector<size_t> runs;
+  for (size_t begin = 0; begin < v.size(); begin += run) runs.push_back(begin);
+  parallel_for_each(runs.size(), [&](size_t i) {
+    std::sort(v.begin() + runs[i],
+              v.begin() + std::min(runs[i] + run, v.size()), comp);
+  });
+  merge_runs(v, runs, comp);
+}
+
+}  // namespace fastlin
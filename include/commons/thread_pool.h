@@ -0,0 +1,61 @@
+#pragma once
+
+#include <algorithm>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+namespace fastlin {
+
+// Fixed set of workers running submitted jobs in FIFO order. Workers live as
+// long as the pool, so their thread-local state stays warm across jobs.
+struct thread_pool {
+ public:
+  explicit thread_pool(size_t workers) {
+    for (size_t i = 0; i < std::max<size_t>(workers, 1); ++i)
+      threads.emplace_back([this] { work(); });
+  }
+
+  ~thread_pool() {
+    {
+      std::lock_guard lock{mtx};
+      stopping = true;
+    }
+    cv.notify_all();
+    for (std::thread& t : threads) t.join();
+  }
+
+  void submit(std::function<void()> job) {
+    {
+      std::lock_guard lock{mtx};
+      jobs.push(std::move(job));
+    }
+    cv.notify_one();
+  }
+
+ private:
+  void work() {
+    while (true) {
+      std::function<void()> job;
+      {
+        std::unique_lock lock{mtx};
+        cv.wait(lock, [this] { return stopping || !jobs.empty(); });
+        if (jobs.empty()) return;
+        job = std::move(jobs.front());
+        jobs.pop();
+      }
+      job();
+    }
+  }
+
+  std::vector<std::thread> threads;
+  std::queue<std::function<void()>> jobs;
+  std::mutex mtx;
+  std::condition_variable cv;
+  bool stopping = false;
+};
+
+}  // namespace fastlin
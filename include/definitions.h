@@ -5,6 +5,8 @@
 #include <string>
 #include <vector>
 
+#include "commons/spill_alloc.h"
+
 namespace fastlin {
 
 typedef unsigned long long time_type;
@@ -29,7 +31,9 @@ typedef unsigned int id_type;
   MACRO(POLL, "poll")                     \
   MACRO(CONTAINS_TRUE, "contains_true")   \
   MACRO(CONTAINS_FALSE, "contains_false") \
-  MACRO(REMOVE, "remove")
+  MACRO(REMOVE, "remove")                 \
+  MACRO(FETCH_ADD, "fetch_add")           \
+  MACRO(READ, "read")
 
 enum Method {
 #define FASTLIN_METHOD_LIST(ENUM, STR) ENUM,
@@ -37,6 +41,11 @@ enum Method {
 #undef FASTLIN_METHOD_LIST
 };
 
+inline constexpr int METHOD_COUNT =
+#define FASTLIN_METHOD_COUNT(ENUM, STR) +1
+    0 FASTLIN_METHOD_EXPAND(FASTLIN_METHOD_COUNT);
+#undef FASTLIN_METHOD_COUNT
+
 inline Method stomethod(const std::string& str) {
 #define FASTLIN_METHOD_TRANSLATE(ENUM, STR) \
   if (str == STR) return Method::ENUM;
@@ -78,10 +87,10 @@ struct operation_t {
 };
 
 template <typename value_type>
-using history_t = std::vector<operation_t<value_type>>;
+using history_t = spill_vector<operation_t<value_type>>;
 
 template <typename value_type>
 using events_t =
-    std::vector<std::tuple<time_type, bool, operation_t<value_type>*>>;
+    spill_vector<std::tuple<time_type, bool, operation_t<value_type>*>>;
 
 }  // namespace fastlin
\ No newline at end of file
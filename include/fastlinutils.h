@@ -1,44 +1,164 @@
 #pragma once
 
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
 #include <queue>
 #include <unordered_map>
 #include <unordered_set>
 
+#include "commons/parallel.h"
+#include "commons/progress.h"
 #include "definitions.h"
+#include "history_columns.h"
 
 namespace fastlin {
 
+// histories shorter than this are preprocessed by a single thread
+inline size_t parallel_min_ops = 1 << 16;
+
 /**
- * - checks for duplicated adds/removes of the same value
- * - extends history using first remove method
- * - O(n)
+ * Calls `f` with a value of the narrowest signed integer type that indexes
+ * arrays and trees over times up to `maxTime`, so that all but histories of
+ * hundreds of millions of operations keep 32-bit indices. Segment trees over
+ * up to twice the times number up to 8 times as many nodes.
  */
-template <typename value_type, typename add_group, typename remove_group>
-bool extend_dist_history(history_t<value_type>& hist,
-                         const value_type& emptyVal) {
-  time_type maxTime = MIN_TIME;
-  id_type maxId = 0;
-  std::unordered_map<value_type, std::pair<int, int>> hasAddRemove;
+template <typename function>
+decltype(auto) with_index_type(time_type maxTime, function f) {
+  if (maxTime <= static_cast<time_type>(INT32_MAX >> 3)) return f(int32_t{});
+  return f(int64_t{});
+}
 
-  for (const auto& o : hist) {
-    maxId = std::max(maxId, o.id);
-    if (o.value == emptyVal) continue;
+/**
+ * Positions of the operations of `hist` on values other than `emptyVal`,
+ * split into shards by the hash of their value so that each shard can be
+ * processed by its own worker, O(n)
+ */
+template <typename history_type, typename value_type>
+struct value_shards {
+ public:
+  value_shards(const history_type& hist, const value_type& emptyVal,
+               size_t count)
+      : hist(hist), emptyVal(emptyVal), count(count) {
+    if (count == 1) return;
+    size_t n = hist.size();
+    chunks.resize(count);
+    parallel_for(
+        count,
+        [&](size_t begin, size_t end) {
+          for (size_t c = begin; c < end; ++c) {
+            chunks[c].resize(count);
+            for (size_t i = c * n / count; i < (c + 1) * n / count; ++i) {
+              const value_type& value = value_at(hist, i);
+              if (value != emptyVal)
+                chunks[c][std::hash<value_type>{}(value) % count].push_back(i);
+            }
+          }
+        },
+        1);
+  }
 
-    auto [map_iter, _] = hasAddRemove.try_emplace(o.value, 0, 0);
-    auto& [hasAdd, hasRemove] = map_iter->second;
-    if (add_group::contains(o.method) && hasAdd++) return false;
-    if (remove_group::contains(o.method) && hasRemove++) return false;
+  size_t size() const { return count; }
 
-    maxTime = std::max(maxTime, o.endTime);
+  // calls `f(i)` on the positions of shard `s` in history order until it
+  // returns false, returning whether it never did
+  template <typename F>
+  bool for_each(size_t s, F f) const {
+    if (count == 1) {
+      for (size_t i = 0; i < hist.size(); ++i)
+        if (value_at(hist, i) != emptyVal && !f(i)) return false;
+      return true;
+    }
+    for (const auto& chunk : chunks)
+      for (size_t i : chunk[s])
+        if (!f(i)) return false;
+    return true;
   }
 
-  for (const auto& [key, value] : hasAddRemove) {
-    auto& [hasAdd, hasRemove] = value;
-    if (!hasAdd) return false;
-    if (!hasRemove)
-      hist.emplace_back(++maxId, remove_group::first, key, maxTime + 1,
-                        maxTime + 2);
+ private:
+  const history_type& hist;
+  const value_type& emptyVal;
+  size_t count;
+  // by the chunk of `hist` they are in, then by shard
+  std::vector<std::vector<std::vector<size_t>>> chunks;
+};
+
+/**
+ * - checks for duplicated adds/removes of the same value
+ * - extends history using first remove method, in order of the values' first
+ *   operations
+ * - values are sharded across workers, each keeping its own table
+ * - O(n)
+ */
+template <typename value_type, typename add_group, typename remove_group,
+          typename history_type = history_t<value_type>>
+bool extend_dist_history(history_type& hist, const value_type& emptyVal) {
+  size_t n = hist.size();
+  progress.phase("extend", n);
+  value_shards shards{hist, emptyVal, n < parallel_min_ops ? 1 : thread_count};
+
+  struct shard_result {
+    bool ok = true;
+    time_type maxTime = MIN_TIME;
+    id_type maxId = 0;
+    // first operation on each value never removed
+    std::vector<std::pair<size_t, value_type>> unremoved;
+  };
+  std::vector<shard_result> results(shards.size());
+  std::atomic<size_t> done{0};
+  parallel_for_each(shards.size(), [&](size_t s) {
+    struct value_counts {
+      size_t first;
+      int adds = 0;
+      int removes = 0;
+    };
+    std::unordered_map<value_type, value_counts> counts;
+    shard_result& res = results[s];
+    size_t processed = 0;
+    res.ok = shards.for_each(s, [&](size_t i) {
+      if (!(++processed & 0xfff)) progress.update(done += 0x1000);
+      auto& c = counts.try_emplace(value_at(hist, i), value_counts{i})
+                    .first->second;
+      Method method = method_at(hist, i);
+      if (add_group::contains(method) && c.adds++) return false;
+      if (remove_group::contains(method) && c.removes++) return false;
+
+      res.maxTime = std::max(res.maxTime, end_at(hist, i));
+      return true;
+    });
+
+    for (const auto& [value, c] : counts) {
+      if (!res.ok) break;
+      if (!c.adds) res.ok = false;
+      if (!c.removes) res.unremoved.emplace_back(c.first, value);
+    }
+  });
+
+  time_type maxTime = MIN_TIME;
+  std::vector<std::pair<size_t, value_type>> unremoved;
+  for (shard_result& res : results) {
+    if (!res.ok) return false;
+    maxTime = std::max(maxTime, res.maxTime);
+    unremoved.insert(unremoved.end(), res.unremoved.begin(),
+                     res.unremoved.end());
   }
+  std::sort(unremoved.begin(), unremoved.end(),
+            [](const auto& a, const auto& b) { return a.first < b.first; });
+
+  size_t chunks = shards.size();
+  std::vector<id_type> maxIds(chunks, 0);
+  parallel_for(
+      chunks,
+      [&](size_t begin, size_t end) {
+        for (size_t c = begin; c < end; ++c)
+          for (size_t i = c * n / chunks; i < (c + 1) * n / chunks; ++i)
+            maxIds[c] = std::max(maxIds[c], id_at(hist, i));
+      },
+      1);
+  id_type maxId = *std::max_element(maxIds.begin(), maxIds.end());
+  for (const auto& [_, value] : unremoved)
+    hist.emplace_back(++maxId, remove_group::first, value, maxTime + 1,
+                      maxTime + 2);
 
   return true;
 };
@@ -56,20 +176,73 @@ void counting_sort(events_t<value_type>& events) {
                                  [&](const auto& a, const auto& b) {
                                    return std::get<0>(a) < std::get<0>(b);
                                  });
-  int maxValue = std::get<0>(*max_it);
+  time_type maxValue = std::get<0>(*max_it);
 
-  std::vector<int> count(maxValue + 1, 0);
-  events_t<value_type> output(events.size());
+  with_index_type(std::max<time_type>(maxValue, events.size()), [&](auto i) {
+    using index_type = decltype(i);
+    spill_vector<index_type> count(maxValue + 1, 0);
+    events_t<value_type> output(events.size());
 
-  for (auto it = events.begin(); it != events.end(); ++it)
-    ++count[std::get<0>(*it)];
+    for (auto it = events.begin(); it != events.end(); ++it)
+      ++count[std::get<0>(*it)];
 
-  for (int i = 1; i <= maxValue; ++i) count[i] += count[i - 1];
+    for (time_type t = 1; t <= maxValue; ++t) count[t] += count[t - 1];
 
-  for (auto it = events.begin(); it != events.end(); ++it)
-    output[count[std::get<0>(*it)] - 1] = *it;
+    for (auto it = events.begin(); it != events.end(); ++it)
+      output[count[std::get<0>(*it)] - 1] = *it;
 
-  std::swap(output, events);
+    std::swap(output, events);
+  });
+}
+
+// more sorted runs than this are sorted from scratch
+inline size_t merge_runs_max = 1 << 10;
+
+// events spanning at most this many times each are counting sorted
+inline size_t counting_sort_span = 4;
+
+inline bool counting_sort_fits(size_t events, time_type span) {
+  return span / counting_sort_span < events;
+}
+
+/**
+ * sorts events, by counting if their times are dense and they are in the
+ * order of their operations as `get_events` lays them out, otherwise k-way
+ * merging them if they already form at most `merge_runs_max` sorted runs, as
+ * when per-thread logs are concatenated, O(n + span) or O(n log k)
+ */
+template <typename value_type>
+void sort_events(events_t<value_type>& events) {
+  if (events.empty()) return;
+  std::vector<size_t> runs{0};
+  time_type minTime = std::get<0>(events[0]), maxTime = minTime;
+  bool opOrder = true;
+  for (size_t i = 1; i < events.size(); ++i) {
+    const auto& [time, _, op] = events[i];
+    minTime = std::min(minTime, time);
+    maxTime = std::max(maxTime, time);
+    opOrder = opOrder && std::get<2>(events[i - 1]) <= op;
+    if (events[i] < events[i - 1] && runs.size() <= merge_runs_max)
+      runs.push_back(i);
+  }
+  if (runs.size() == 1) return;
+
+  if (opOrder && counting_sort_fits(events.size(), maxTime - minTime)) {
+    // stable on (time, invocation), leaving ties in operation order
+    auto key = [minTime](const auto& e) {
+      return (std::get<0>(e) - minTime) << 1 | std::get<1>(e);
+    };
+    spill_vector<size_t> count(((maxTime - minTime) << 1) + 3, 0);
+    for (const auto& e : events) ++count[key(e) + 1];
+    for (size_t k = 1; k < count.size(); ++k) count[k] += count[k - 1];
+    events_t<value_type> sorted(events.size());
+    for (const auto& e : events) sorted[count[key(e)]++] = e;
+    events.swap(sorted);
+  } else if (runs.size() > merge_runs_max) {
+    sort_within_budget(events);
+  } else {
+    merge_runs(events, runs);
+  }
 }
 
 /**
@@ -77,12 +250,14 @@ void counting_sort(events_t<value_type>& events) {
  */
 template <typename value_type>
 events_t<value_type> get_events(history_t<value_type>& hist) {
-  events_t<value_type> events;
-  events.reserve(hist.size() << 1);
-  for (operation_t<value_type>& o : hist) {
-    events.emplace_back(o.startTime, true, &o);
-    events.emplace_back(o.endTime, false, &o);
-  }
+  events_t<value_type> events(hist.size() << 1);
+  parallel_for(hist.size(), [&](size_t begin, size_t end) {
+    for (size_t i = begin; i < end; ++i) {
+      operation_t<value_type>& o = hist[i];
+      events[i << 1] = {o.startTime, true, &o};
+      events[i << 1 | 1] = {o.endTime, false, &o};
+    }
+  });
   return events;
 }
 
@@ -93,7 +268,9 @@ events_t<value_type> get_events(history_t<value_type>& hist) {
 template <typename value_type, typename add_group, typename remove_group>
 bool tune_events(events_t<value_type>& events, const value_type& emptyVal,
                  const id_type& maxId) {
-  std::sort(events.begin(), events.end());
+  progress.phase("tune_events");
+  sort_events(events);
+  progress.phase("tune_events", events.size());
 
   using oper_ptr = operation_t<value_type>*;
   struct value_event_data {
@@ -107,7 +284,9 @@ bool tune_events(events_t<value_type>& events, const value_type& emptyVal,
   std::vector<bool> ongoings_op(maxId + 1, false);
 
   time_type time = MIN_TIME;
+  size_t processed = 0;
   for (const auto& [_, isInv, o] : events) {
+    if (!(++processed & 0xfff)) progress.update(processed);
     const value_type& value = o->value;
     value_event_data& data = ongoings_val[value];
 
@@ -135,17 +314,22 @@ bool tune_events(events_t<value_type>& events, const value_type& emptyVal,
       }
     } else {
       if (add_group::contains(o->method)) {
+        // already responded for an operation on its value that responded
+        if (data.add_ended) continue;
         o->endTime = ++time;
         data.add_ended = true;
       } else if (remove_group::contains(o->method)) {
         if (data.add_op == NULL) return false;
-        if (!data.add_ended) data.add_op->endTime = ++time;
+        if (!data.add_ended) {
+          data.add_op->endTime = ++time;
+          data.add_ended = true;
+        }
         while (!data.others.empty()) {
           auto* op = data.others.front();
+          data.others.pop_front();
           if (!ongoings_op[op->id]) continue;
           ongoings_op[op->id] = false;
           op->endTime = ++time;
-          data.others.pop_front();
         }
         data.remove_op->endTime = ++time;
         data.remove_ended = true;
@@ -169,7 +353,9 @@ bool tune_events(events_t<value_type>& events, const value_type& emptyVal,
 template <typename value_type, typename add_group>
 bool tune_events_x(events_t<value_type>& events, const value_type& emptyVal,
                    const id_type& maxId) {
-  std::sort(events.begin(), events.end());
+  progress.phase("tune_events");
+  sort_events(events);
+  progress.phase("tune_events", events.size());
 
   using oper_ptr = operation_t<value_type>*;
   struct value_event_data {
@@ -180,7 +366,9 @@ bool tune_events_x(events_t<value_type>& events, const value_type& emptyVal,
   std::unordered_map<value_type, value_event_data> ongoings_val;
 
   time_type time = MIN_TIME;
+  size_t processed = 0;
   for (const auto& [_, isInv, o] : events) {
+    if (!(++processed & 0xfff)) progress.update(processed);
     const value_type& value = o->value;
     value_event_data& data = ongoings_val[value];
 
@@ -200,11 +388,16 @@ bool tune_events_x(events_t<value_type>& events, const value_type& emptyVal,
       }
     } else {
       if (add_group::contains(o->method)) {
+        // already responded for a remove that responded
+        if (data.add_ended) continue;
         o->endTime = ++time;
         data.add_ended = true;
       } else {
         if (data.add_op == NULL) return false;
-        if (!data.add_ended) data.add_op->endTime = ++time;
+        if (!data.add_ended) {
+          data.add_op->endTime = ++time;
+          data.add_ended = true;
+        }
         data.remove_op->endTime = ++time;
       }
     }
@@ -219,13 +412,17 @@ bool tune_events_x(events_t<value_type>& events, const value_type& emptyVal,
 // O(n log n)
 template <typename value_type, typename add_group, typename remove_group>
 bool verify_empty(events_t<value_type>& events, const value_type& emptyVal) {
+  progress.phase("verify_empty");
   counting_sort(events);
+  progress.phase("verify_empty", events.size());
 
   std::unordered_set<id_type> runningEmptyOp;
   std::unordered_set<value_type> critVal;
-  int critValCnt = 0;
+  size_t critValCnt = 0;
 
+  size_t processed = 0;
   for (const auto& [_, isInv, op] : events) {
+    if (!(++processed & 0xfff)) progress.update(processed);
     if (op->value != emptyVal) {
       if (isInv && remove_group::contains(op->method) &&
           !critVal.insert(op->value).second)
@@ -246,22 +443,236 @@ bool verify_empty(events_t<value_type>& events, const value_type& emptyVal) {
   return true;
 }
 
+// stable, compacting chunks of the history concurrently
+template <typename value_type>
+void remove_empty(history_t<value_type>& hist, const value_type& emptyVal) {
+  size_t chunks = hist.size() < parallel_min_ops ? 1 : thread_count;
+  if (chunks == 1) {
+    hist.erase(std::remove_if(
+                   hist.begin(), hist.end(),
+                   [&emptyVal](const auto& o) { return o.value == emptyVal; }),
+               hist.end());
+    return;
+  }
+
+  size_t n = hist.size();
+  std::vector<size_t> offsets(chunks + 1, 0);
+  parallel_for(
+      chunks,
+      [&](size_t begin, size_t end) {
+        for (size_t c = begin; c < end; ++c)
+          for (size_t i = c * n / chunks; i < (c + 1) * n / chunks; ++i)
+            offsets[c + 1] += hist[i].value != emptyVal;
+      },
+      1);
+  for (size_t c = 1; c <= chunks; ++c) offsets[c] += offsets[c - 1];
+
+  history_t<value_type> kept(offsets.back());
+  parallel_for(
+      chunks,
+      [&](size_t begin, size_t end) {
+        for (size_t c = begin; c < end; ++c) {
+          size_t pos = offsets[c];
+          for (size_t i = c * n / chunks; i < (c + 1) * n / chunks; ++i)
+            if (hist[i].value != emptyVal) kept[pos++] = hist[i];
+        }
+      },
+      1);
+  hist.swap(kept);
+}
+
 template <typename value_type>
 void remove_empty(history_t<value_type>& hist, events_t<value_type>& events,
                   const value_type& emptyVal) {
-  hist.erase(std::remove_if(
-                 hist.begin(), hist.end(),
-                 [&emptyVal](const auto& o) { return o.value == emptyVal; }),
-             hist.end());
+  remove_empty(hist, emptyVal);
   events = get_events(hist);  // pointers can be invalid
 }
 
 template <typename value_type>
-void remove_empty(history_t<value_type>& hist, const value_type& emptyVal) {
-  hist.erase(std::remove_if(
-                 hist.begin(), hist.end(),
-                 [&emptyVal](const auto& o) { return o.value == emptyVal; }),
-             hist.end());
+time_type max_end_time(const history_t<value_type>& hist) {
+  time_type maxTime = MIN_TIME;
+  for (const auto& o : hist) maxTime = std::max(maxTime, o.endTime);
+  return maxTime;
+}
+
+// operations the last `reduce_history` on this thread pruned, for reporting
+inline thread_local size_t pruned_ops = 0;
+
+/**
+ * - prunes values whose operations overlap no operation on another value and
+ *   can be linearized on their own, as no other value is in the container
+ *   meanwhile
+ * - prunes peeks whose interval contains that of another peek on the same
+ *   value, as both can take effect at the same point
+ * - renumbers ids and times of what is left densely from 1
+ * - `hist` must be tuned and without empty operations
+ * - O(n) expected besides sorting the peeks
+ */
+template <typename value_type, typename add_group, typename remove_group>
+void reduce_history(history_t<value_type>& hist) {
+  pruned_ops = 0;
+  if (hist.empty()) return;
+  progress.phase("reduce", hist.size());
+
+  struct value_span {
+    size_t index;
+    time_type minStart = MAX_TIME, maxEnd = MIN_TIME;
+    // linearizable alone iff the add is invoked before every other operation
+    // responds and the remove responds after every other one is invoked
+    time_type addStart = MAX_TIME, removeEnd = MIN_TIME;
+    time_type othersMinEnd = MAX_TIME, othersMaxStart = MIN_TIME;
+    bool pruned = false;
+  };
+  std::unordered_map<value_type, value_span> spans;
+  std::vector<value_span*> spanOf(hist.size());
+  for (size_t i = 0; i < hist.size(); ++i) {
+    const auto& o = hist[i];
+    value_span& v =
+        spans.try_emplace(o.value, value_span{spans.size()}).first->second;
+    spanOf[i] = &v;
+    v.minStart = std::min(v.minStart, o.startTime);
+    v.maxEnd = std::max(v.maxEnd, o.endTime);
+    if (add_group::contains(o.method))
+      v.addStart = o.startTime;
+    else
+      v.othersMinEnd = std::min(v.othersMinEnd, o.endTime);
+    if (remove_group::contains(o.method))
+      v.removeEnd = o.endTime;
+    else
+      v.othersMaxStart = std::max(v.othersMaxStart, o.startTime);
+  }
+
+  // `crowded[t]` counts the times before `t` within the spans of two values
+  time_type maxTime = max_end_time(hist);
+  spill_vector<size_t> crowded(maxTime + 2, 0);
+  with_index_type(maxTime, [&](auto i) {
+    using index_type = decltype(i);
+    spill_vector<index_type> delta(maxTime + 2, 0);
+    for (const auto& [_, v] : spans) {
+      ++delta[v.minStart];
+      --delta[v.maxEnd + 1];
+    }
+    index_type covering = 0;
+    for (time_type t = 0; t <= maxTime; ++t) {
+      covering += delta[t];
+      crowded[t + 1] = crowded[t] + (covering > 1);
+    }
+  });
+  for (auto& [_, v] : spans)
+    v.pruned = crowded[v.maxEnd + 1] == crowded[v.minStart] &&
+               v.addStart < v.othersMinEnd && v.removeEnd > v.othersMaxStart;
+
+  // peeks by value then invocation, each kept only if every peek invoked
+  // later on the same value also responds later
+  std::vector<size_t> peeks;
+  for (size_t i = 0; i < hist.size(); ++i)
+    if (!add_group::contains(hist[i].method) &&
+        !remove_group::contains(hist[i].method) && !spanOf[i]->pruned)
+      peeks.push_back(i);
+  std::sort(peeks.begin(), peeks.end(), [&](size_t a, size_t b) {
+    return spanOf[a]->index < spanOf[b]->index ||
+           (spanOf[a] == spanOf[b] && hist[a].startTime < hist[b].startTime);
+  });
+  std::vector<bool> keep(hist.size(), true);
+  time_type minEnd = MAX_TIME;
+  for (size_t j = peeks.size(); j--;) {
+    if (j + 1 == peeks.size() || spanOf[peeks[j]] != spanOf[peeks[j + 1]])
+      minEnd = MAX_TIME;
+    if (hist[peeks[j]].endTime > minEnd) keep[peeks[j]] = false;
+    minEnd = std::min(minEnd, hist[peeks[j]].endTime);
+  }
+
+  // compacts the operations left, then their times
+  spill_vector<time_type> rank(maxTime + 1, 0);
+  size_t kept = 0;
+  for (size_t i = 0; i < hist.size(); ++i) {
+    if (!keep[i] || spanOf[i]->pruned) continue;
+    rank[hist[i].startTime] = rank[hist[i].endTime] = 1;
+    hist[kept] = hist[i];
+    hist[kept].id = kept + 1;
+    ++kept;
+  }
+  pruned_ops = hist.size() - kept;
+  if (!pruned_ops) return;
+  hist.resize(kept);
+  for (time_type t = 1; t <= maxTime; ++t) rank[t] += rank[t - 1];
+  for (auto& o : hist) {
+    o.startTime = rank[o.startTime];
+    o.endTime = rank[o.endTime];
+  }
+}
+
+/**
+ * - splits a tuned history without empty operations at quiescent points, i.e.
+ *   times at which no operation is running and every value added before has
+ *   been removed, so that the parts can be checked independently
+ * - ids and times of each part are renumbered from 1, as the engines size
+ *   their tables by them
+ * - O(n)
+ */
+template <typename value_type>
+std::vector<history_t<value_type>> split_quiescent(
+    const history_t<value_type>& hist) {
+  // each value spans from its first invocation to its last response
+  std::unordered_map<value_type, std::pair<time_type, time_type>> spans;
+  for (const auto& o : hist) {
+    auto [iter, inserted] =
+        spans.try_emplace(o.value, o.startTime, o.endTime);
+    if (inserted) continue;
+    iter->second.first = std::min(iter->second.first, o.startTime);
+    iter->second.second = std::max(iter->second.second, o.endTime);
+  }
+
+  time_type maxTime = max_end_time(hist);
+  // a part starts wherever a span starts with none running
+  spill_vector<size_t> partOf(maxTime + 1);
+  std::vector<time_type> partStart;
+  with_index_type(maxTime, [&](auto i) {
+    using index_type = decltype(i);
+    spill_vector<index_type> delta(maxTime + 1, 0);
+    for (const auto& [_, span] : spans) {
+      ++delta[span.first];
+      --delta[span.second];
+    }
+    index_type running = 0;
+    for (time_type t = 0; t <= maxTime; ++t) {
+      if (!running && delta[t] > 0) partStart.push_back(t);
+      running += delta[t];
+      partOf[t] = partStart.size() - 1;
+    }
+  });
+
+  std::vector<history_t<value_type>> parts(partStart.size());
+  for (const auto& o : hist) {
+    size_t part = partOf[o.startTime];
+    auto& op = parts[part].emplace_back(o);
+    op.id = parts[part].size();
+    op.startTime -= partStart[part] - 1;
+    op.endTime -= partStart[part] - 1;
+  }
+  return parts;
+}
+
+// histories shorter than this are not worth splitting
+inline size_t split_min_ops = 1 << 12;
+
+// Checks a tuned history without empty operations with `check`, splitting it
+// at quiescent points to check the parts concurrently if there are threads to
+// spare; all workers stop picking up parts once one of them is rejected
+template <typename value_type, typename checker>
+bool check_segments(history_t<value_type>& hist, checker check) {
+  if (thread_count <= 1 || hist.size() < split_min_ops) return check(hist);
+
+  progress.phase("split_quiescent");
+  std::vector<history_t<value_type>> parts = split_quiescent(hist);
+  if (parts.size() <= 1) return check(hist);
+
+  std::atomic<bool> violated{false};
+  parallel_for_each(parts.size(), [&](size_t i) {
+    if (!violated.load(std::memory_order_relaxed) && !check(parts[i]))
+      violated.store(true, std::memory_order_relaxed);
+  });
+  return !violated;
 }
 
 }  // namespace fastlin
@@ -0,0 +1,109 @@
+#pragma once
+
+#include <cstdint>
+
+#include "definitions.h"
+
+namespace fastlin {
+
+static_assert(METHOD_COUNT <= UINT8_MAX, "method codes must fit a byte");
+
+// A history stored field by field, so that passes reading only a few fields of
+// every operation stream through just those. Fills and reads like `history_t`
+// through `emplace_back` and the accessors below.
+template <typename value_type>
+struct history_columns {
+ public:
+  size_t size() const { return ids.size(); }
+  bool empty() const { return ids.empty(); }
+
+  void reserve(size_t n) {
+    ids.reserve(n);
+    methods.reserve(n);
+    values.reserve(n);
+    starts.reserve(n);
+    ends.reserve(n);
+  }
+
+  void emplace_back(id_type id, Method method, const value_type& value,
+                    time_type startTime, time_type endTime) {
+    ids.push_back(id);
+    methods.push_back(static_cast<uint8_t>(method));
+    values.push_back(value);
+    starts.push_back(startTime);
+    ends.push_back(endTime);
+  }
+
+  operation_t<value_type> operator[](size_t i) const {
+    return {ids[i], static_cast<Method>(methods[i]), values[i], starts[i],
+            ends[i]};
+  }
+
+  history_t<value_type> to_history() const {
+    history_t<value_type> hist;
+    hist.reserve(size());
+    for (size_t i = 0; i < size(); ++i) hist.push_back((*this)[i]);
+    return hist;
+  }
+
+  spill_vector<id_type> ids;
+  spill_vector<uint8_t> methods;
+  spill_vector<value_type> values;
+  spill_vector<time_type> starts;
+  spill_vector<time_type> ends;
+};
+
+// Field accessors taking either `history_t` or `history_columns`
+
+template <typename value_type>
+id_type id_at(const history_t<value_type>& hist, size_t i) {
+  return hist[i].id;
+}
+
+template <typename value_type>
+Method method_at(const history_t<value_type>& hist, size_t i) {
+  return hist[i].method;
+}
+
+template <typename value_type>
+const value_type& value_at(const history_t<value_type>& hist, size_t i) {
+  return hist[i].value;
+}
+
+template <typename value_type>
+time_type start_at(const history_t<value_type>& hist, size_t i) {
+  return hist[i].startTime;
+}
+
+template <typename value_type>
+time_type end_at(const history_t<value_type>& hist, size_t i) {
+  return hist[i].endTime;
+}
+
+template <typename value_type>
+id_type id_at(const history_columns<value_type>& hist, size_t i) {
+  return hist.ids[i];
+}
+
+template <typename value_type>
+Method method_at(const history_columns<value_type>& hist, size_t i) {
+  return static_cast<Method>(hist.methods[i]);
+}
+
+template <typename value_type>
+const value_type& value_at(const history_columns<value_type>& hist,
+                           size_t i) {
+  return hist.values[i];
+}
+
+template <typename value_type>
+time_type start_at(const history_columns<value_type>& hist, size_t i) {
+  return hist.starts[i];
+}
+
+template <typename value_type>
+time_type end_at(const history_columns<value_type>& hist, size_t i) {
+  return hist.ends[i];
+}
+
+}  // namespace fastlin
@@ -1,36 +1,213 @@
 #pragma once
 
+#include <algorithm>
+#include <charconv>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
 #include <fstream>
-#include <sstream>
+#include <optional>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
 
+#include "commons/progress.h"
 #include "definitions.h"
 
 namespace fastlin {
 
+// Binary histories start with `BINARY_MAGIC` followed by the data type and a
+// newline, then hold one `binary_record` per operation in native byte order
+inline constexpr char BINARY_MAGIC[] = "\x7f" "FLH1";
+
+struct binary_record {
+  int64_t value;
+  uint64_t startTime;
+  uint64_t endTime;
+  uint32_t method;
+  uint32_t reserved;
+};
+static_assert(sizeof(binary_record) == 32);
+
 template <typename value_type>
 struct history_reader {
  public:
   history_reader(const std::string& path) : path(path) {}
 
   history_t<value_type> get_hist() {
+    std::ifstream f(path);
+    history_t<value_type> hist;
+    progress.phase("read");
+    read(f, hist);
+    return hist;
+  }
+
+  // Reads the rows appended after byte `offset`, numbering them after
+  // `lastId`. Only newline-terminated rows are consumed so that a row still
+  // being written is left for the next call; `offset` is advanced past them.
+  history_t<value_type> get_appended(std::streamoff& offset, id_type lastId) {
     std::ifstream f(path);
     std::string line;
     history_t<value_type> hist;
-    id_type id = 0;
+    f.seekg(offset);
+    while (std::getline(f, line) && !f.eof()) {
+      offset += line.size() + 1;
+      parse_row(line, hist, lastId);
+    }
+    return hist;
+  }
+
+  // Whether rows can still be read from byte `offset` on, i.e. the file holds
+  // a newline right before it rather than having been truncated or replaced
+  // by a shorter one
+  bool resumable(std::streamoff offset) const {
+    if (!offset) return true;
+    std::ifstream f(path);
+    f.seekg(offset - 1);
+    return f.get() == '\n';
+  }
+
+  // Reads a whole text or binary history from `in` into `hist` in a single
+  // pass, so that `in` may be a pipe, returning its data type
+  template <typename history_type>
+  static std::string read(std::istream& in, history_type& hist) {
+    bool binary;
+    std::string type = read_header(in, binary);
+    read_rows(in, hist, binary);
+    return type;
+  }
+
+  // Consumes the header of a text or binary history from `in`, returning its
+  // data type, for the caller to pick a container before `read_rows`
+  static std::string read_header(std::istream& in, bool& binary) {
+    std::string line;
+    binary = in.peek() == BINARY_MAGIC[0];
+    if (binary) {
+      std::string magic(sizeof(BINARY_MAGIC) - 1, '\0');
+      in.read(magic.data(), magic.size());
+      if (magic != BINARY_MAGIC || !std::getline(in, line))
+        throw std::invalid_argument("Malformed binary history");
+      return trim(line);
+    }
+    if (in.peek() == '#' && std::getline(in, line)) return trim(line.substr(1));
+    return "";
+  }
+
+  // `hist` may be a `history_t` or `history_columns`, rows read are numbered
+  // after those already in `hist`
+  template <typename history_type>
+  static void read_rows(std::istream& in, history_type& hist, bool binary) {
+    id_type id = hist.size();
+    if (!binary) {
+      parse_rows(in, hist, id);
+      return;
+    }
+    binary_record r;
+    while (in.read(reinterpret_cast<char*>(&r), sizeof(r))) {
+      if (r.method >= METHOD_COUNT)
+        throw std::invalid_argument("Unknown method: " +
+                                    std::to_string(r.method));
+      hist.emplace_back(++id, static_cast<Method>(r.method),
+                        static_cast<value_type>(r.value), r.startTime,
+                        r.endTime);
+    }
+  }
+
+  // The files listed by a manifest, one per line after a `# threads` header
+  // and relative to it, or none if `path` is not a manifest
+  static std::vector<std::string> read_manifest(const std::string& path) {
+    std::ifstream f(path);
+    std::string line;
+    std::vector<std::string> files;
+    if (!std::getline(f, line) || trim(line) != "# threads") return files;
+
+    std::filesystem::path dir = std::filesystem::path(path).parent_path();
     while (std::getline(f, line)) {
-      std::stringstream ss{line};
       line = trim(line);
       if (line.empty() || line[0] == '#') continue;
+      files.push_back((dir / line).string());
+    }
+    if (files.empty()) throw std::invalid_argument("Empty manifest " + path);
+    return files;
+  }
 
-      std::string methodStr;
-      value_type value;
-      time_type startTime, endTime;
+  /**
+   * Reads a log of separate invocation and completion events in a single
+   * pass, pairing them by process and numbering them in order of arrival for
+   * timestamps. Each line is either `<process> <type> <method> [value]` or a
+   * Jepsen-style map such as `{:process 0, :type :ok, :f :pop, :value 5}`,
+   * where `type` is one of `invoke`, `ok`, `fail` or `info`. A completion
+   * without a value (or `nil`) takes that of its invocation, else `emptyVal`.
+   * Failed operations are left out. Adds that never complete or end in `info`
+   * may have taken effect, and are completed after the last event; other
+   * such operations are left out, their results being unknown. Lines of
+   * other processes, e.g. `:nemesis`, and `#` lines are skipped.
+   */
+  template <typename history_type>
+  static void read_events(std::istream& in, history_type& hist,
+                          const value_type& emptyVal) {
+    struct invocation {
+      Method method;
+      std::optional<value_type> value;
+      time_type startTime;
+    };
+    std::unordered_map<long long, invocation> running;
+    std::vector<invocation> unfinished;
+    id_type id = hist.size();
+    time_type now = 0;
 
-      ss >> methodStr >> value >> startTime >> endTime;
+    for_each_line(in, [&](std::string_view line) {
+      event e;
+      if (!parse_event(line, e)) return;
+      ++now;
+      if (e.type != "invoke" && e.type != "ok" && e.type != "fail" &&
+          e.type != "info")
+        throw std::invalid_argument("Unknown event type " +
+                                    std::string(e.type) + " at event " +
+                                    std::to_string(now));
+      auto iter = running.find(e.process);
+      if (e.type == "invoke") {
+        if (iter != running.end())
+          throw std::invalid_argument("Process " + std::to_string(e.process) +
+                                      " invoked twice at event " +
+                                      std::to_string(now));
+        running.emplace(e.process, invocation{e.method, e.value, now});
+        return;
+      }
+      if (iter == running.end())
+        throw std::invalid_argument("Process " + std::to_string(e.process) +
+                                    " completed nothing at event " +
+                                    std::to_string(now));
+      invocation op = iter->second;
+      running.erase(iter);
+      if (e.type == "ok")
+        hist.emplace_back(++id, op.method,
+                          e.value ? *e.value : op.value.value_or(emptyVal),
+                          op.startTime, now);
+      else if (e.type == "info")
+        unfinished.push_back(op);
+    });
 
-      hist.emplace_back(++id, stomethod(methodStr), value, startTime, endTime);
+    for (auto& [_, op] : running) unfinished.push_back(op);
+    std::sort(unfinished.begin(), unfinished.end(),
+              [](const invocation& a, const invocation& b) {
+                return a.startTime < b.startTime;
+              });
+    for (const invocation& op : unfinished) {
+      switch (op.method) {
+        case Method::PUSH:
+        case Method::ENQ:
+        case Method::INSERT:
+        case Method::PUSH_FRONT:
+        case Method::PUSH_BACK:
+          if (op.value)
+            hist.emplace_back(++id, op.method, *op.value, op.startTime,
+                              now + 1);
+          break;
+        default:
+          break;
+      }
     }
-    return hist;
   }
 
   std::string get_type_s() {
@@ -42,10 +219,176 @@ struct history_reader {
   }
 
  private:
-  std::string trim(const std::string& str) {
-    size_t start = str.find_first_not_of(' ');
+  static constexpr size_t BLOCK_SIZE = 1 << 20;
+
+  template <typename history_type>
+  static void parse_rows(std::istream& in, history_type& hist, id_type& id) {
+    for_each_line(in,
+                  [&](std::string_view line) { parse_row(line, hist, id); });
+  }
+
+  // Passes the lines of `in` to `f`, reading a block at a time and carrying a
+  // line cut off at the end of a block over to the next one
+  template <typename line_function>
+  static void for_each_line(std::istream& in, line_function f) {
+    std::vector<char> buf(BLOCK_SIZE);
+    size_t carry = 0;
+    while (true) {
+      in.read(buf.data() + carry, buf.size() - carry);
+      size_t len = carry + in.gcount();
+      std::string_view block{buf.data(), len};
+      size_t pos = 0;
+      for (size_t nl; (nl = block.find('\n', pos)) != block.npos; pos = nl + 1)
+        f(block.substr(pos, nl - pos));
+      if (!in) {
+        f(block.substr(pos));
+        return;
+      }
+
+      carry = len - pos;
+      std::memmove(buf.data(), buf.data() + pos, carry);
+      if (carry == buf.size()) buf.resize(buf.size() << 1);  // very long row
+      progress.check();
+    }
+  }
+
+  template <typename history_type>
+  static void parse_row(std::string_view line, history_type& hist,
+                        id_type& id) {
+    std::string_view methodStr = next_token(line);
+    if (methodStr.empty() || methodStr[0] == '#') return;
+
+    value_type value;
+    time_type startTime, endTime;
+    if (!parse_token(next_token(line), value) ||
+        !parse_token(next_token(line), startTime) ||
+        !parse_token(next_token(line), endTime))
+      throw std::invalid_argument("Malformed row for operation " +
+                                  std::to_string(id + 1));
+
+    hist.emplace_back(++id, stomethod(std::string(methodStr)), value,
+                      startTime, endTime);
+  }
+
+  struct event {
+    long long process;
+    std::string_view type;
+    Method method;
+    std::optional<value_type> value;
+  };
+
+  // returns whether `line` is an event of a numbered process
+  static bool parse_event(std::string_view line, event& e) {
+    size_t start = line.find_first_not_of(" \t\r");
+    if (start == line.npos || line[start] == '#') return false;
+
+    std::string_view process, method, value;
+    if (line[start] != '{') {
+      process = next_token(line);
+      e.type = next_token(line);
+      method = next_token(line);
+      value = next_token(line);
+    } else {
+      std::string_view map = line.substr(start + 1);
+      while (true) {
+        std::string_view key = next_datum(map);
+        if (key.empty() || key == "}") break;
+        std::string_view datum = next_datum(map);
+        if (key == ":process")
+          process = datum;
+        else if (key == ":type")
+          e.type = keyword(datum);
+        else if (key == ":f")
+          method = keyword(datum);
+        else if (key == ":value")
+          value = datum;
+      }
+    }
+
+    if (!parse_token(process, e.process)) return false;
+    if (e.type.empty() || method.empty())
+      throw std::invalid_argument("Malformed event of process " +
+                                  std::to_string(e.process));
+    e.method = stomethod(std::string(method));
+    e.value.reset();
+    if (!value.empty() && value != "nil") {
+      value_type v;
+      if (!parse_token(value, v))
+        throw std::invalid_argument("Malformed value " + std::string(value) +
+                                    " of process " +
+                                    std::to_string(e.process));
+      e.value = v;
+    }
+    return true;
+  }
+
+  // `:name` as `name`
+  static std::string_view keyword(std::string_view datum) {
+    if (!datum.empty() && datum[0] == ':') datum.remove_prefix(1);
+    return datum;
+  }
+
+  // pops the first datum off the inside of a map, where commas are
+  // whitespace and strings and collections are single data
+  static std::string_view next_datum(std::string_view& map) {
+    size_t start = map.find_first_not_of(" \t\r,");
+    if (start == map.npos) {
+      map = {};
+      return map;
+    }
+    size_t end = start;
+    int depth = 0;
+    bool quoted = false;
+    for (; end < map.size(); ++end) {
+      char c = map[end];
+      if (quoted) {
+        if (c == '\\')
+          ++end;
+        else if (c == '"')
+          quoted = false;
+      } else if (c == '"') {
+        quoted = true;
+      } else if (c == '[' || c == '(' || c == '{') {
+        ++depth;
+      } else if (c == ']' || c == ')' || c == '}') {
+        if (!depth) break;
+        --depth;
+      } else if (!depth && (c == ' ' || c == '\t' || c == '\r' || c == ',')) {
+        break;
+      }
+    }
+    // the closing brace of the map itself
+    if (end == start) ++end;
+    std::string_view datum = map.substr(start, end - start);
+    map.remove_prefix(std::min(end, map.size()));
+    return datum;
+  }
+
+  // pops the first whitespace separated token off `line`
+  static std::string_view next_token(std::string_view& line) {
+    constexpr std::string_view space = " \t\r";
+    size_t start = line.find_first_not_of(space);
+    if (start == line.npos) {
+      line = {};
+      return line;
+    }
+    size_t end = std::min(line.find_first_of(space, start), line.size());
+    std::string_view token = line.substr(start, end - start);
+    line.remove_prefix(end);
+    return token;
+  }
+
+  template <typename T>
+  static bool parse_token(std::string_view token, T& out) {
+    const char* end = token.data() + token.size();
+    auto [ptr, ec] = std::from_chars(token.data(), end, out);
+    return ec == std::errc() && ptr == end;
+  }
+
+  static std::string trim(const std::string& str) {
+    size_t start = str.find_first_not_of(" \t\r");
     if (start == std::string::npos) return "";
-    size_t end = str.find_last_not_of(' ');
+    size_t end = str.find_last_not_of(" \t\r");
     if (end == std::string::npos) return "";
     return str.substr(start, end - start + 1);
   }
@@ -53,4 +396,4 @@ struct history_reader {
   const std::string path;
 };
 
-}  // namespace fastlin
\ No newline at end of file
+}  // namespace fastlin
@@ -0,0 +1,104 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <optional>
+#include <ostream>
+#include <vector>
+
+#include "algo/stack_lin.h"
+#include "definitions.h"
+#include "history_columns.h"
+
+namespace fastlin {
+
+/**
+ * Shape of a history, which is what the cost of the engines depends on.
+ * - concurrency: `concurrency[k]` invocations found `k` other operations
+ *   running, reported as level `k + 1`
+ * - interval lengths: `lengths[b]` operations took between `2^(b-1)` and
+ *   `2^b - 1` time units (`lengths[0]` took none)
+ * - quiescent points: times at which no operation is running between two
+ *   operations
+ */
+template <typename value_type>
+struct history_stats {
+ public:
+  // `hist` may be a `history_t` or `history_columns`
+  template <typename history_type>
+  history_stats(const history_type& hist, const value_type& emptyVal)
+      : operations(hist.size()) {
+    std::vector<std::pair<time_type, bool>> events;
+    events.reserve(hist.size() << 1);
+    for (size_t i = 0; i < hist.size(); ++i) {
+      time_type startTime = start_at(hist, i), endTime = end_at(hist, i);
+      ++methodCounts[method_at(hist, i)];
+      emptyOps += value_at(hist, i) == emptyVal;
+      size_t bucket = std::bit_width(endTime - startTime);
+      if (lengths.size() <= bucket) lengths.resize(bucket + 1);
+      ++lengths[bucket];
+      events.emplace_back(startTime, true);
+      events.emplace_back(endTime, false);
+    }
+
+    // responses first at equal times, as in `tune_events`
+    std::sort(events.begin(), events.end());
+    size_t running = 0;
+    for (const auto& [_, isInv] : events) {
+      if (!isInv) {
+        quiescentPoints += !--running;
+        continue;
+      }
+      if (concurrency.size() <= running) concurrency.resize(running + 1);
+      ++concurrency[running++];
+    }
+    if (quiescentPoints) --quiescentPoints;  // end of history
+  }
+
+  // only meaningful for stack histories
+  void add_stack_nesting(const history_t<value_type>& hist,
+                         const value_type& emptyVal) {
+    criticalNesting = stack::max_critical_nesting(hist, emptyVal);
+    hasCriticalNesting = true;
+  }
+
+  void print(std::ostream& out) const {
+    out << "operations " << operations << "\n";
+    for (int m = 0; m < METHOD_COUNT; ++m)
+      if (methodCounts[m])
+        out << "method " << methodtos(static_cast<Method>(m)) << " "
+            << methodCounts[m] << "\n";
+    out << "empty_value_fraction "
+        << (operations ? static_cast<double>(emptyOps) / operations : 0)
+        << "\n";
+    out << "max_concurrency " << concurrency.size() << "\n";
+    for (size_t k = 0; k < concurrency.size(); ++k)
+      if (concurrency[k])
+        out << "concurrency " << k + 1 << " " << concurrency[k] << "\n";
+    for (size_t b = 0; b < lengths.size(); ++b)
+      if (lengths[b])
+        out << "interval_length " << (b ? 1ULL << (b - 1) : 0) << "-"
+            << (b ? (1ULL << b) - 1 : 0) << " " << lengths[b] << "\n";
+    out << "quiescent_points " << quiescentPoints << "\n";
+    if (hasCriticalNesting) {
+      out << "critical_nesting ";
+      if (criticalNesting)
+        out << *criticalNesting << "\n";
+      else
+        out << "rejected\n";
+    }
+  }
+
+ private:
+  size_t operations;
+  std::array<size_t, METHOD_COUNT> methodCounts{};
+  size_t emptyOps = 0;
+  std::vector<size_t> concurrency;
+  std::vector<size_t> lengths;
+  size_t quiescentPoints = 0;
+  bool hasCriticalNesting = false;
+  std::optional<size_t> criticalNesting;
+};
+
+}  // namespace fastlin
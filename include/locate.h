@@ -0,0 +1,159 @@
+#pragma once
+
+#include <algorithm>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "commons/parallel.h"
+#include "commons/progress.h"
+#include "history_columns.h"
+
+namespace fastlin {
+
+/**
+ * The prefix of a history up to time `T` holds the peeks, contains and
+ * operations on the empty value that responded by `T`, and all adds and
+ * removes of the values with an operation that responded by `T`. For a
+ * counter, it holds the reads that responded by `T` and the fetch_adds
+ * returning less than any operation that responded by `T` needs. Dropping
+ * the other operations from a linearization of the history leaves one of the
+ * prefix, so that once a prefix is not linearizable, neither is any longer
+ * one.
+ */
+
+// when a violation first shows, and the operations joining the prefix then
+struct location {
+  time_type time;
+  std::vector<id_type> ids;
+};
+
+// the time from which each operation is in the prefix, O(n) expected
+template <typename history_type, typename value_type>
+std::vector<time_type> prefix_times(const std::string& type,
+                                    const history_type& hist,
+                                    const value_type& emptyVal) {
+  std::vector<time_type> times(hist.size());
+  if (type == "counter") {
+    // the fetch_adds returning `v` join once one returning `v` or more, or a
+    // read of more than `v`, responded. Values past the number of fetch_adds
+    // cannot all be returned, and count as needing every fetch_add.
+    size_t fetchAdds = 0;
+    for (size_t i = 0; i < hist.size(); ++i)
+      fetchAdds += method_at(hist, i) == Method::FETCH_ADD;
+    auto capped = [&](value_type v) {
+      return static_cast<size_t>(
+          std::min<value_type>(v, static_cast<value_type>(fetchAdds)));
+    };
+    std::vector<time_type> needs(fetchAdds + 2, MAX_TIME);
+    for (size_t i = 0; i < hist.size(); ++i) {
+      if (value_at(hist, i) < 0) continue;
+      size_t v = capped(value_at(hist, i));
+      if (method_at(hist, i) == Method::READ)
+        v = value_at(hist, i) ? capped(value_at(hist, i) - 1) : fetchAdds + 1;
+      needs[v] = std::min(needs[v], end_at(hist, i));
+    }
+    for (size_t v = fetchAdds; v--;)
+      needs[v] = std::min(needs[v], needs[v + 1]);
+    for (size_t i = 0; i < hist.size(); ++i)
+      times[i] =
+          method_at(hist, i) == Method::FETCH_ADD && value_at(hist, i) >= 0
+              ? needs[capped(value_at(hist, i))]
+              : end_at(hist, i);
+    return times;
+  }
+
+  std::unordered_map<value_type, time_type> firstEnd;
+  for (size_t i = 0; i < hist.size(); ++i) {
+    if (value_at(hist, i) == emptyVal) continue;
+    auto [iter, _] = firstEnd.try_emplace(value_at(hist, i), MAX_TIME);
+    iter->second = std::min(iter->second, end_at(hist, i));
+  }
+  for (size_t i = 0; i < hist.size(); ++i) {
+    switch (method_at(hist, i)) {
+      case Method::PUSH:
+      case Method::POP:
+      case Method::ENQ:
+      case Method::DEQ:
+      case Method::INSERT:
+      case Method::POLL:
+      case Method::REMOVE:
+        if (value_at(hist, i) != emptyVal) {
+          times[i] = firstEnd[value_at(hist, i)];
+          break;
+        }
+        [[fallthrough]];
+      default:
+        times[i] = end_at(hist, i);
+    }
+  }
+  return times;
+}
+
+/**
+ * Finds the earliest prefix `check` rejects, or none if it accepts the whole
+ * history. Probes prefixes of exponentially growing length first, as
+ * violations tend to show early, then narrows down between the last accepted
+ * and the first rejected, `thread_count` probes at a time. Each probe copies
+ * its prefix from `hist` (`history_t` or `history_columns`), left as is.
+ */
+template <typename history_type, typename value_type, typename checker>
+std::optional<location> locate(const std::string& type,
+                               const history_type& hist,
+                               const value_type& emptyVal, checker check) {
+  progress.phase("locate");
+  std::vector<time_type> times = prefix_times(type, hist, emptyVal);
+  std::vector<time_type> cuts = times;
+  std::sort(cuts.begin(), cuts.end());
+  cuts.erase(std::unique(cuts.begin(), cuts.end()), cuts.end());
+
+  auto rejects = [&](size_t cut) {
+    history_t<value_type> prefix;
+    for (size_t i = 0; i < hist.size(); ++i)
+      if (times[i] <= cuts[cut])
+        prefix.emplace_back(id_at(hist, i), method_at(hist, i),
+                            value_at(hist, i), start_at(hist, i),
+                            end_at(hist, i));
+    return !check(prefix, emptyVal);
+  };
+  // probes `probes` concurrently, narrowing `(lo, hi]` to hold the earliest
+  // rejected cut, `lo` of `-1` meaning none is known to be accepted
+  long lo = -1, hi = static_cast<long>(cuts.size()) - 1;
+  auto narrow = [&](const std::vector<long>& probes) {
+    std::vector<char> rejected(probes.size());
+    parallel_for_each(probes.size(),
+                      [&](size_t i) { rejected[i] = rejects(probes[i]); });
+    for (size_t i = 0; i < probes.size(); ++i) {
+      if (rejected[i]) {
+        hi = probes[i];
+        return true;
+      }
+      lo = probes[i];
+    }
+    return false;
+  };
+
+  if (cuts.empty() || !rejects(hi)) return std::nullopt;
+  for (long next = 0; next < hi;) {
+    std::vector<long> probes;
+    for (; probes.size() < thread_count && next < hi; next = next * 2 + 1)
+      probes.push_back(next);
+    if (narrow(probes)) break;
+  }
+  while (hi - lo > 1) {
+    std::vector<long> probes;
+    size_t count = std::min<size_t>(thread_count, hi - lo - 1);
+    for (size_t i = 1; i <= count; ++i)
+      probes.push_back(lo + static_cast<long>((hi - lo) * i / (count + 1)));
+    probes.erase(std::unique(probes.begin(), probes.end()), probes.end());
+    narrow(probes);
+  }
+
+  location found{cuts[hi], {}};
+  for (size_t i = 0; i < hist.size(); ++i)
+    if (times[i] == cuts[hi]) found.ids.push_back(id_at(hist, i));
+  return found;
+}
+
+}  // namespace fastlin
@@ -0,0 +1,245 @@
+#pragma once
+
+#include <algorithm>
+#include <queue>
+#include <set>
+#include <stdexcept>
+#include <unordered_map>
+
+#include "algo/queue_lin.h"
+#include "algo/set_lin.h"
+
+namespace fastlin {
+
+/**
+ * Online monitors, fed operations of a live object as they happen rather than
+ * a recorded history. Each operation is reported by `on_invoke` and then by
+ * `on_response` with its method and value, both in the order they happen.
+ * `on_response` returns false once the history is known not to be
+ * linearizable, and `finish` gives the verdict of the whole history, the same
+ * as the offline engine would. Values may be added again once retired, unlike
+ * offline, and a set value need not be added at all if it is only ever found
+ * absent.
+ */
+
+// invocations still awaiting their response
+struct running_ops {
+ public:
+  void invoke(id_type id, time_type time) {
+    if (!starts.emplace(id, time).second)
+      throw std::invalid_argument("Operation " + std::to_string(id) +
+                                  " invoked twice");
+    byStart.insert(time);
+    last = std::max(last, time);
+  }
+
+  // returns the invocation time
+  time_type respond(id_type id, time_type time) {
+    auto iter = starts.find(id);
+    if (iter == starts.end())
+      throw std::invalid_argument("Operation " + std::to_string(id) +
+                                  " responded without invocation");
+    time_type start = iter->second;
+    starts.erase(iter);
+    byStart.erase(byStart.find(start));
+    last = std::max(last, time);
+    return start;
+  }
+
+  // every operation yet to respond was or will be invoked from then on
+  time_type watermark() const {
+    return byStart.empty() ? last : std::min(*byStart.begin(), last);
+  }
+
+  size_t size() const { return starts.size(); }
+
+ private:
+  std::unordered_map<id_type, time_type> starts;
+  std::multiset<time_type> byStart;
+  time_type last = MIN_TIME;
+};
+
+/**
+ * Keeps the reductions of `set::is_linearizable` per value. A violation is
+ * flagged as soon as the operations seen so far, together with the fact that
+ * later ones are invoked after the watermark, imply it. A value is retired
+ * once the watermark passes the response of its remove.
+ */
+template <typename value_type>
+struct set_monitor {
+ public:
+  void on_invoke(id_type id, time_type time) { running.invoke(id, time); }
+
+  bool on_response(id_type id, Method method, const value_type& value,
+                   time_type time) {
+    time_type start = running.respond(id, time);
+    if (!ok) return false;
+
+    auto iter = states.find(value);
+    if (method == Method::CONTAINS_FALSE) {
+      // later operations respond after it started, so only values already
+      // present before it can be contradicted
+      if (iter == states.end() || iter->second.minRes >= start) return expire();
+      value_state& s = iter->second;
+      s.minAbsentEnd = std::min(s.minAbsentEnd, time);
+      if (!s.removes) deadlines.emplace(time, value);
+      ok = !violates(s);
+      return expire();
+    }
+
+    value_state& s = iter != states.end() ? iter->second : states[value];
+    s.minRes = std::min(s.minRes, time);
+    s.maxInv = std::max(s.maxInv, start);
+    if (method == Method::INSERT) {
+      ok = !s.adds++;
+      s.addInv = start;
+    } else if (method == Method::REMOVE) {
+      ok = !s.removes++;
+      s.removeRes = time;
+    }
+    deadlines.emplace(s.removes ? s.removeRes : s.minRes, value);
+    ok = ok && !violates(s);
+    return expire();
+  }
+
+  // the history is complete
+  bool finish() {
+    for (const auto& [_, s] : states) ok = ok && !violates(s, MAX_TIME);
+    states.clear();
+    deadlines = {};
+    return ok;
+  }
+
+  bool violated() const { return !ok; }
+
+  // values still in play
+  size_t tracked() const { return states.size(); }
+
+ private:
+  struct value_state {
+    int adds = 0;
+    int removes = 0;
+    time_type addInv = MIN_TIME;
+    time_type removeRes = MAX_TIME;
+    // over all but contains_false operations
+    time_type minRes = MAX_TIME;
+    time_type maxInv = MIN_TIME;
+    // earliest response of a contains_false invoked after `minRes`
+    time_type minAbsentEnd = MAX_TIME;
+  };
+
+  // whether the operations seen, and those yet to come being invoked from
+  // `watermark` on, contradict `s`
+  static bool violates(const value_state& s,
+                       time_type watermark = MIN_TIME) {
+    time_type maxInv = std::max(s.maxInv, s.removes ? MIN_TIME : watermark);
+    return (s.adds ? s.addInv : watermark) > s.minRes ||
+           s.removeRes < s.maxInv || s.minAbsentEnd < maxInv;
+  }
+
+  // checks values whose deadline the watermark passed, retiring them once
+  // their remove responded
+  bool expire() {
+    time_type watermark = running.watermark();
+    while (ok && !deadlines.empty() && deadlines.top().first < watermark) {
+      value_type value = deadlines.top().second;
+      deadlines.pop();
+      auto iter = states.find(value);
+      if (iter == states.end()) continue;
+      ok = !violates(iter->second, watermark);
+      if (iter->second.removes && iter->second.removeRes < watermark)
+        states.erase(iter);
+    }
+    return ok;
+  }
+
+  bool ok = true;
+  running_ops running;
+  std::unordered_map<value_type, value_state> states;
+  // earliest first
+  std::priority_queue<std::pair<time_type, value_type>,
+                      std::vector<std::pair<time_type, value_type>>,
+                      std::greater<>>
+      deadlines;
+};
+
+/**
+ * Buffers operations until a quiescent point, where no operation is running
+ * and every value added was also removed, then checks the buffer with
+ * `queue::is_linearizable` and drops it, as nothing after the point can
+ * affect it. Memory is thus bounded by the operations between quiescent
+ * points only, and grows for as long as the queue is never drained.
+ *
+ * Whenever no operation is running and the buffer doubled since the last
+ * check, the buffer is also checked as is, its values yet to be dequeued
+ * then being dequeued later on. That can only reject what the whole history
+ * rejects, and flags violations within twice the operations it took for them
+ * to show, O(n log n) amortized.
+ */
+template <typename value_type>
+struct queue_monitor {
+ public:
+  explicit queue_monitor(const value_type& emptyVal) : emptyVal(emptyVal) {}
+
+  void on_invoke(id_type id, time_type time) { running.invoke(id, time); }
+
+  bool on_response(id_type id, Method method, const value_type& value,
+                   time_type time) {
+    time_type start = running.respond(id, time);
+    if (!ok) return false;
+    buffer.emplace_back(buffer.size() + 1, method, value, start, time);
+
+    if (value != emptyVal) {
+      auto [iter, inserted] = openVals.try_emplace(value, 0, 0);
+      auto& [hasAdd, hasRemove] = iter->second;
+      bool wasClosed = hasAdd && hasRemove;
+      if (queue::add_methods::contains(method) && hasAdd++) ok = false;
+      if (queue::remove_methods::contains(method) && hasRemove++) ok = false;
+      closedVals += !wasClosed && hasAdd && hasRemove;
+    }
+    if (!ok || running.size()) return ok;
+    if (closedVals == openVals.size())
+      check();
+    else if (buffer.size() >= probeAt)
+      probe();
+    return ok;
+  }
+
+  // the history is complete
+  bool finish() {
+    if (ok) check();
+    return ok;
+  }
+
+  bool violated() const { return !ok; }
+
+  // operations buffered since the last quiescent point
+  size_t buffered() const { return buffer.size(); }
+
+ private:
+  void check() {
+    ok = queue::is_linearizable(buffer, emptyVal);
+    buffer.clear();
+    openVals.clear();
+    closedVals = 0;
+    probeAt = 1;
+  }
+
+  // checks a copy, as the engine rewrites times and extends the history
+  void probe() {
+    history_t<value_type> copy = buffer;
+    ok = queue::is_linearizable(copy, emptyVal);
+    probeAt = buffer.size() << 1;
+  }
+
+  value_type emptyVal;
+  bool ok = true;
+  running_ops running;
+  history_t<value_type> buffer;
+  std::unordered_map<value_type, std::pair<int, int>> openVals;
+  size_t closedVals = 0;
+  // buffer size at which to check it next short of a quiescent point
+  size_t probeAt = 1;
+};
+
+}  // namespace fastlin
@@ -0,0 +1,150 @@
+#pragma once
+
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "fastlinutils.h"
+#include "history_columns.h"
+#include "witness.h"
+
+namespace fastlin {
+
+/**
+ * Engines a history may be checked with. `STANDARD` is the full engine of the
+ * data type, `NO_PEEKS` the one without peeks, contains or reads (`-x`), and
+ * `REPLAY` applies the operations in invocation order to the sequential
+ * specification, which only decides histories whose operations do not
+ * overlap. `SEARCH` searches for an order to apply them in, which suits
+ * histories with few operations running at once.
+ */
+enum class engine { AUTO, STANDARD, NO_PEEKS, REPLAY, SEARCH };
+
+inline const char* engine_name(engine e) {
+  switch (e) {
+    case engine::AUTO:
+      return "auto";
+    case engine::STANDARD:
+      return "standard";
+    case engine::NO_PEEKS:
+      return "no-peeks";
+    case engine::REPLAY:
+      return "replay";
+    case engine::SEARCH:
+      return "search";
+  }
+  return "";
+}
+
+inline engine parse_engine(const std::string& name) {
+  for (engine e : {engine::AUTO, engine::STANDARD, engine::NO_PEEKS,
+                   engine::REPLAY, engine::SEARCH})
+    if (name == engine_name(e)) return e;
+  throw std::invalid_argument("Unknown engine " + name);
+}
+
+// what the planner looks at, gathered in one pass
+struct history_profile {
+  size_t operations = 0;
+  // peeks, contains or reads, which only the standard engines check
+  bool peeks = false;
+  // rows in invocation order, each invoked after all before it responded
+  bool sequential = true;
+  // the empty value is added, or appears at all in a set, which the engines
+  // treat differently from the specification
+  bool emptyAdded = false;
+  time_type minTime = MAX_TIME, maxTime = MIN_TIME;
+};
+
+template <typename history_type, typename value_type>
+history_profile profile_history(const std::string& type,
+                                const history_type& hist,
+                                const value_type& emptyVal) {
+  history_profile profile;
+  profile.operations = hist.size();
+  time_type maxEnd = MIN_TIME;
+  for (size_t i = 0; i < hist.size(); ++i) {
+    Method method = method_at(hist, i);
+    time_type start = start_at(hist, i), end = end_at(hist, i);
+    switch (method) {
+      case Method::PEEK:
+      case Method::PEEK_FRONT:
+      case Method::PEEK_BACK:
+      case Method::CONTAINS_TRUE:
+      case Method::CONTAINS_FALSE:
+      case Method::READ:
+        profile.peeks = true;
+        break;
+      case Method::PUSH:
+      case Method::ENQ:
+      case Method::INSERT:
+      case Method::PUSH_FRONT:
+      case Method::PUSH_BACK:
+        profile.emptyAdded |= value_at(hist, i) == emptyVal;
+        break;
+      default:
+        break;
+    }
+    if (type == "set") profile.emptyAdded |= value_at(hist, i) == emptyVal;
+    profile.sequential = profile.sequential && (!i || start > maxEnd);
+    maxEnd = std::max(maxEnd, end);
+    profile.minTime = std::min(profile.minTime, start);
+    profile.maxTime = std::max(profile.maxTime, end);
+  }
+  return profile;
+}
+
+struct plan {
+  engine chosen;
+
+  // e.g. `engine no-peeks`
+  std::string describe() const {
+    return std::string("engine ") + engine_name(chosen);
+  }
+};
+
+/**
+ * Replays a history with no two operations overlapping, whose rows are in
+ * invocation order, so that the rows are its only possible linearization,
+ * O(n)
+ */
+template <typename history_type, typename value_type>
+bool replay(const std::string& type, const history_type& hist,
+            const value_type& emptyVal) {
+  progress.phase("replay");
+  std::vector<id_type> order(hist.size());
+  for (size_t i = 0; i < hist.size(); ++i) order[i] = id_at(hist, i);
+  return check_witness(type, hist, order, emptyVal);
+}
+
+/**
+ * Picks the engine for a history, unless `forced`: replaying sequential
+ * histories, and leaving out peeks when there are none, or when asked to with
+ * `exclude_peeks`. Throws if the forced engine cannot check the history.
+ */
+inline plan make_plan(const std::string& type, const history_profile& profile,
+                      bool exclude_peeks, engine forced) {
+  bool replayable =
+      profile.sequential && !profile.emptyAdded && type != "counter";
+  if (forced == engine::REPLAY && !replayable)
+    throw std::invalid_argument(
+        "The replay engine needs rows in invocation order that do not "
+        "overlap");
+  if (forced == engine::SEARCH && profile.emptyAdded)
+    throw std::invalid_argument(
+        "The search engine needs the empty value never to be added");
+  if (exclude_peeks && forced != engine::AUTO && forced != engine::NO_PEEKS)
+    throw std::invalid_argument("-x only goes with the no-peeks engine");
+
+  plan p{forced};
+  if (forced != engine::AUTO) return p;
+  if (exclude_peeks)
+    p.chosen = engine::NO_PEEKS;
+  else if (replayable)
+    p.chosen = engine::REPLAY;
+  else
+    p.chosen = profile.peeks ? engine::STANDARD : engine::NO_PEEKS;
+  return p;
+}
+
+}  // namespace fastlin
@@ -0,0 +1,136 @@
+#pragma once
+
+#include <cstdint>
+#include <initializer_list>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "algo/priorityqueue_lin.h"
+#include "algo/queue_lin.h"
+#include "algo/set_lin.h"
+#include "algo/stack_lin.h"
+#include "fastlinutils.h"
+
+namespace fastlin {
+
+inline constexpr size_t NO_ROW = SIZE_MAX;
+
+// operations that alone show a history is not linearizable
+struct violation {
+  std::string reason;
+  std::vector<id_type> ids;
+};
+
+/**
+ * Checks conditions that every history accepted by the engines meets, each
+ * comparing an operation with the add or remove of its value only:
+ * - every value is added exactly once and removed at most once
+ * - no operation responds before its value is added
+ * - no operation other than the remove is invoked after the remove responded
+ * - no set `contains_false` runs entirely while its value is present
+ * Takes an unprocessed `hist` (`history_t` or `history_columns`), reporting
+ * the violation of the earliest row, or none. With `exclude_peeks`, peeks and
+ * contains are only checked for their value being added. Values are sharded
+ * across workers, O(n).
+ */
+template <typename add_group, typename remove_group, typename history_type,
+          typename value_type>
+std::optional<violation> prefilter(const history_type& hist,
+                                   const value_type& emptyVal,
+                                   bool exclude_peeks) {
+  progress.phase("prefilter");
+  value_shards shards{hist, emptyVal,
+                      hist.size() < parallel_min_ops ? 1 : thread_count};
+
+  struct shard_result {
+    size_t row = NO_ROW;
+    violation found;
+
+    void report(size_t i, const char* reason,
+                std::initializer_list<size_t> rows, const history_type& hist) {
+      if (i >= row) return;
+      row = i;
+      found.reason = reason;
+      found.ids.clear();
+      for (size_t r : rows) found.ids.push_back(id_at(hist, r));
+    }
+  };
+  std::vector<shard_result> results(shards.size());
+  parallel_for_each(shards.size(), [&](size_t s) {
+    // rows of the add and remove of each value
+    std::unordered_map<value_type, std::pair<size_t, size_t>> ends;
+    shard_result& res = results[s];
+    shards.for_each(s, [&](size_t i) {
+      auto& [add, remove] =
+          ends.try_emplace(value_at(hist, i), NO_ROW, NO_ROW).first->second;
+      Method method = method_at(hist, i);
+      if (add_group::contains(method)) {
+        if (add == NO_ROW)
+          add = i;
+        else
+          res.report(i, "value added twice", {add, i}, hist);
+      } else if (remove_group::contains(method)) {
+        if (remove == NO_ROW)
+          remove = i;
+        else
+          res.report(i, "value removed twice", {remove, i}, hist);
+      }
+      return true;
+    });
+
+    // only rows before the earliest violation so far can replace it
+    shards.for_each(s, [&](size_t i) {
+      if (i >= res.row) return false;
+      Method method = method_at(hist, i);
+      if (add_group::contains(method)) return true;
+      auto [add, remove] = ends[value_at(hist, i)];
+      if (add == NO_ROW) {
+        res.report(i, "value never added", {i}, hist);
+        return false;
+      }
+
+      bool peek = !remove_group::contains(method);
+      if (method == Method::CONTAINS_FALSE) {
+        if (!exclude_peeks && start_at(hist, i) > end_at(hist, add) &&
+            (remove == NO_ROW || end_at(hist, i) < start_at(hist, remove)))
+          res.report(i, "value missed while present", {add, i}, hist);
+      } else if (peek && exclude_peeks) {
+      } else if (end_at(hist, i) < start_at(hist, add)) {
+        res.report(i, "responds before its value is added", {add, i}, hist);
+      } else if (peek && remove != NO_ROW &&
+                 start_at(hist, i) > end_at(hist, remove)) {
+        res.report(i, "invoked after its value is removed", {remove, i},
+                   hist);
+      }
+      return res.row == NO_ROW;
+    });
+  });
+
+  shard_result* first = nullptr;
+  for (shard_result& res : results)
+    if (res.row != NO_ROW && (!first || res.row < first->row)) first = &res;
+  if (!first) return std::nullopt;
+  return first->found;
+}
+
+template <typename history_type, typename value_type>
+std::optional<violation> prefilter(const std::string& type,
+                                   const history_type& hist,
+                                   const value_type& emptyVal,
+                                   bool exclude_peeks) {
+#define SUPPORT_DS(TYPE)                                        \
+  if (type == #TYPE)                                            \
+    return prefilter<TYPE::add_methods, TYPE::remove_methods>( \
+        hist, emptyVal, exclude_peeks);
+  SUPPORT_DS(set);
+  SUPPORT_DS(stack);
+  SUPPORT_DS(queue);
+  SUPPORT_DS(priorityqueue);
+#undef SUPPORT_DS
+  // the counter engine is a single linear pass already
+  return std::nullopt;
+}
+
+}  // namespace fastlin
@@ -0,0 +1,212 @@
+#pragma once
+
+#include <time.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "history_reader.h"
+
+namespace fastlin {
+
+// where the timestamps of recorded operations come from; `TSC` falls back to
+// `MONOTONIC` where there is no time stamp counter
+enum class recorder_clock { MONOTONIC, TSC };
+
+/**
+ * Records the operations of a data structure under test as a binary history,
+ * e.g.
+ *
+ *   fastlin::recorder rec{"stack.bin", "stack"};
+ *   // on each thread
+ *   time_type start = rec.now();
+ *   int v = s.pop();
+ *   rec.record(Method::POP, v, start);
+ *
+ * Each recording thread appends to a lock-free ring buffer of its own, which
+ * a background thread drains into the file as is, so that recording takes
+ * two timestamps and a 32-byte copy. A thread only waits when its ring is
+ * full. The history is complete once the recorder is destroyed, and
+ * operations must not be recorded concurrently with that.
+ */
+struct recorder {
+ public:
+  recorder(const std::string& path, const std::string& type,
+           recorder_clock clock = recorder_clock::MONOTONIC,
+           size_t ring_capacity = 1 << 16,
+           std::chrono::microseconds flush_interval =
+               std::chrono::milliseconds(1))
+      : out(path, std::ios::binary),
+        tsc(clock == recorder_clock::TSC && has_tsc),
+        capacity(std::bit_ceil(std::max<size_t>(ring_capacity, 2))),
+        key(next_key()++) {
+    if (!out) throw std::invalid_argument("Cannot open " + path);
+    out.write(BINARY_MAGIC, sizeof(BINARY_MAGIC) - 1);
+    out << type << "\n";
+    flusher = std::thread([this, flush_interval] {
+      std::unique_lock lock{mtx};
+      while (!stopping) {
+        cv.wait_for(lock, flush_interval);
+        lock.unlock();
+        flush();
+        lock.lock();
+      }
+    });
+  }
+
+  recorder(const recorder&) = delete;
+  recorder& operator=(const recorder&) = delete;
+
+  ~recorder() {
+    {
+      std::lock_guard lock{mtx};
+      stopping = true;
+    }
+    cv.notify_one();
+    flusher.join();
+    flush();
+  }
+
+  // a timestamp to take before invoking an operation
+  time_type now() const {
+#if defined(__x86_64__) || defined(__i386__)
+    if (tsc) {
+      // keeps the operation from starting before the timestamp
+      time_type t = __rdtsc();
+      _mm_lfence();
+      return t;
+    }
+#endif
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<time_type>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+  }
+
+  // records an operation invoked at `start` that responded just now
+  void record(Method method, int64_t value, time_type start) {
+    record(method, value, start, end_time());
+  }
+
+  void record(Method method, int64_t value, time_type start, time_type end) {
+    ring& r = local();
+    size_t head = r.head.load(std::memory_order_relaxed);
+    while (head - r.tailSeen >= capacity) {
+      r.tailSeen = r.tail.load(std::memory_order_acquire);
+      if (head - r.tailSeen >= capacity) {
+        cv.notify_one();
+        std::this_thread::yield();
+      }
+    }
+    r.records[head & (capacity - 1)] = {value, start, end,
+                                        static_cast<uint32_t>(method), 0};
+    r.head.store(head + 1, std::memory_order_release);
+  }
+
+ private:
+#if defined(__x86_64__) || defined(__i386__)
+  static constexpr bool has_tsc = true;
+#else
+  static constexpr bool has_tsc = false;
+#endif
+
+  // single producer, the recording thread, and single consumer, the flusher
+  struct ring {
+    // zeroed up front, so that recording never faults pages in
+    explicit ring(size_t capacity) : records(new binary_record[capacity]()) {}
+
+    std::unique_ptr<binary_record[]> records;
+    alignas(64) std::atomic<size_t> head{0};
+    // the producer's last look at `tail`, sparing it the shared cache line
+    size_t tailSeen = 0;
+    alignas(64) std::atomic<size_t> tail{0};
+  };
+
+  // a timestamp to take once an operation responded
+  time_type end_time() const {
+#if defined(__x86_64__) || defined(__i386__)
+    if (tsc) {
+      // waits for the operation to complete before reading the counter
+      unsigned aux;
+      return __rdtscp(&aux);
+    }
+#endif
+    return now();
+  }
+
+  // recorders are told apart by a key rather than their address, which a
+  // later recorder may reuse
+  static std::atomic<uint64_t>& next_key() {
+    static std::atomic<uint64_t> key{1};
+    return key;
+  }
+
+  // the ring of the calling thread, looked up by key as a thread may record
+  // to several recorders in turn; keys of destroyed recorders are never
+  // reused, so their stale entries are harmless
+  ring& local() {
+    thread_local uint64_t cachedKey = 0;
+    thread_local ring* cached = nullptr;
+    if (cachedKey == key) return *cached;
+    thread_local std::unordered_map<uint64_t, ring*> owned;
+    ring*& r = owned[key];
+    if (!r) {
+      std::lock_guard lock{ringsMtx};
+      r = rings.emplace_back(std::make_unique<ring>(capacity)).get();
+    }
+    cached = r;
+    cachedKey = key;
+    return *cached;
+  }
+
+  // writes out what every ring holds, on the flusher or once it stopped
+  void flush() {
+    std::vector<ring*> snapshot;
+    {
+      std::lock_guard lock{ringsMtx};
+      for (auto& r : rings) snapshot.push_back(r.get());
+    }
+    for (ring* r : snapshot) {
+      size_t tail = r->tail.load(std::memory_order_relaxed);
+      size_t head = r->head.load(std::memory_order_acquire);
+      while (tail != head) {
+        size_t from = tail & (capacity - 1);
+        size_t count = std::min(head - tail, capacity - from);
+        out.write(reinterpret_cast<const char*>(&r->records[from]),
+                  count * sizeof(binary_record));
+        tail += count;
+      }
+      r->tail.store(tail, std::memory_order_release);
+    }
+    out.flush();
+  }
+
+  std::ofstream out;
+  bool tsc;
+  size_t capacity;
+  uint64_t key;
+
+  std::mutex ringsMtx;
+  std::vector<std::unique_ptr<ring>> rings;
+
+  std::mutex mtx;
+  std::condition_variable cv;
+  bool stopping = false;
+  std::thread flusher;
+};
+
+}  // namespace fastlin
@@ -0,0 +1,158 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <numeric>
+#include <stdexcept>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+#include "commons/progress.h"
+#include "history_columns.h"
+#include "sequential_spec.h"
+
+namespace fastlin {
+
+/**
+ * Searches for a linearization of an unprocessed `hist` (`history_t` or
+ * `history_columns`) by replaying its operations on `spec_type`, in the
+ * manner of Wing and Gong with Lowe's memoization. Operations are invoked in
+ * order of invocation, each as soon as no operation invoked but not yet
+ * applied responded before it. Any of those pending may be applied next, so
+ * that the search branches over at most `w` operations at a time for a
+ * history with at most `w` operations running at once. A configuration
+ * (operations applied, `state` of the object) is explored at most once, told
+ * apart exactly by the number of operations invoked, those of them pending and
+ * the state.
+ * Takes O(n w) when the first choices mostly succeed, exponential time in
+ * the worst case, and builds no trees. `emptyVal` must never be added.
+ */
+template <template <typename> typename spec_type, typename history_type,
+          typename value_type>
+bool search_linearization(const history_type& hist,
+                          const value_type& emptyVal) {
+  progress.phase("search", hist.size());
+  size_t n = hist.size();
+  std::vector<size_t> order(n);
+  std::iota(order.begin(), order.end(), 0);
+  std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+    return start_at(hist, a) < start_at(hist, b);
+  });
+
+  spec_type<value_type> spec{emptyVal};
+  // invoked but not yet applied, by time of response as those responding
+  // first tend to take effect first, and how many were invoked
+  std::vector<size_t> pending;
+  size_t invoked = 0;
+  auto by_end = [&](size_t a, size_t b) {
+    return end_at(hist, a) < end_at(hist, b);
+  };
+
+  // invokes the next operations while none pending responded before them,
+  // as responses come first at equal times
+  auto invoke = [&] {
+    time_type minEnd = MAX_TIME;
+    for (size_t i : pending) minEnd = std::min(minEnd, end_at(hist, i));
+    for (; invoked < n && start_at(hist, order[invoked]) < minEnd; ++invoked) {
+      size_t i = order[invoked];
+      pending.insert(std::upper_bound(pending.begin(), pending.end(), i,
+                                      by_end),
+                     i);
+      minEnd = std::min(minEnd, end_at(hist, i));
+    }
+  };
+
+  // applying the operation at `pos` of `pending`, with `invoked` before
+  struct move {
+    size_t pos;
+    size_t row;
+    size_t invoked;
+  };
+  auto apply = [&](size_t pos) {
+    size_t i = pending[pos];
+    pending.erase(pending.begin() + pos);
+    move m{pos, i, invoked};
+    invoke();
+    return m;
+  };
+  auto undo = [&](const move& m) {
+    for (; invoked > m.invoked; --invoked) {
+      size_t i = order[invoked - 1];
+      pending.erase(std::find(pending.begin(), pending.end(), i));
+    }
+    pending.insert(pending.begin() + m.pos, m.row);
+    spec.undo(method_at(hist, m.row), value_at(hist, m.row));
+  };
+
+  struct config_hash {
+    size_t operator()(const std::vector<size_t>& c) const {
+      uint64_t h = 0;
+      for (size_t i = 0; i < c.size(); ++i) h += placed_hash(c[i], i);
+      return h;
+    }
+  };
+  // configurations entered, as the number of operations invoked, the state
+  // and the rows pending in order; the operations applied are those invoked
+  // but not pending
+  std::unordered_set<std::vector<size_t>, config_hash> seen;
+  auto config = [&] {
+    std::vector<size_t> c{invoked, spec.state()};
+    c.insert(c.end(), pending.begin(), pending.end());
+    std::sort(c.begin() + 2, c.end());
+    return c;
+  };
+
+  invoke();
+  if (pending.empty()) return spec.finish();
+  seen.insert(config());
+
+  // each frame tries the pending operations in turn, holding the move that
+  // led to it
+  struct frame {
+    size_t next;
+    move from;
+  };
+  std::vector<frame> frames{{0, {}}};
+  size_t steps = 0;
+  while (true) {
+    if (!(++steps & 0xfff)) progress.update(invoked);
+    bool descended = false;
+    while (frames.back().next < pending.size()) {
+      size_t pos = frames.back().next++;
+      size_t i = pending[pos];
+      if (!spec.apply(method_at(hist, i), value_at(hist, i))) continue;
+      move m = apply(pos);
+      if (pending.empty()) {
+        if (spec.finish()) return true;
+      } else if (seen.insert(config()).second) {
+        frames.push_back({0, m});
+        descended = true;
+        break;
+      }
+      undo(m);
+    }
+    if (descended) continue;
+
+    move from = frames.back().from;
+    frames.pop_back();
+    if (frames.empty()) return false;
+    undo(from);
+  }
+}
+
+template <typename history_type, typename value_type>
+bool search_linearization(const std::string& type, const history_type& hist,
+                          const value_type& emptyVal) {
+#define SUPPORT_DS(TYPE) \
+  if (type == #TYPE) return search_linearization<TYPE##_spec>(hist, emptyVal);
+  SUPPORT_DS(set);
+  SUPPORT_DS(stack);
+  SUPPORT_DS(queue);
+  SUPPORT_DS(priorityqueue);
+  SUPPORT_DS(counter);
+#undef SUPPORT_DS
+  throw std::invalid_argument("Unknown data type");
+}
+
+}  // namespace fastlin
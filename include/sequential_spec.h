@@ -0,0 +1,365 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <set>
+#include <tuple>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "definitions.h"
+
+namespace fastlin {
+
+/**
+ * Sequential specifications of the data types. `apply` performs an operation
+ * on the object if its return value is the one the object would give, and
+ * returns whether it was, while `finish` tells whether the history may end
+ * there. `undo` reverts the last operation applied, given the same arguments.
+ * `state` identifies whatever of the state does not follow from the set of
+ * operations applied, i.e. the order of the values in a stack or queue, so
+ * that two states are equal iff their ids are. Removing from or peeking at an
+ * empty container returns `emptyVal`. As the engines assume, every value is
+ * added exactly once, and never `emptyVal`.
+ */
+
+// a value at a position, scrambled for hash tables
+template <typename value_type>
+uint64_t placed_hash(const value_type& value, uint64_t position) {
+  uint64_t x =
+      std::hash<value_type>{}(value) + (position + 1) * 0x9e3779b97f4a7c15;
+  x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9;
+  x = (x ^ (x >> 27)) * 0x94d049bb133111eb;
+  return x ^ (x >> 31);
+}
+
+/**
+ * Stacks of values interned as cons cells, each holding the top value and
+ * the id of the stack below, so that equal stacks get equal ids, `0` being
+ * the empty one. O(1) expected per operation.
+ */
+template <typename value_type>
+struct interned_stack {
+ public:
+  size_t push(size_t below, const value_type& value) {
+    auto [iter, inserted] = ids.try_emplace({below, value}, cells.size() + 1);
+    if (inserted) cells.push_back(below);
+    return iter->second;
+  }
+
+  size_t pop(size_t top) const { return cells[top - 1]; }
+
+ private:
+  struct cell_hash {
+    size_t operator()(const std::pair<size_t, value_type>& c) const {
+      return placed_hash(c.second, c.first);
+    }
+  };
+
+  std::unordered_map<std::pair<size_t, value_type>, size_t, cell_hash> ids;
+  // the stack below each id
+  std::vector<size_t> cells;
+};
+
+/**
+ * Sequences of distinct values interned as hash-consed Cartesian trees, in
+ * order in-order and heap-ordered by the hash of their values. As the tree of
+ * a sequence is unique, equal sequences get equal ids, `0` being the empty
+ * one. Operations at either end copy a spine, O(log n) expected.
+ */
+template <typename value_type>
+struct interned_sequence {
+ public:
+  size_t push_back(size_t t, const value_type& value) {
+    return merge(t, make(0, 0, value));
+  }
+
+  size_t push_front(size_t t, const value_type& value) {
+    return merge(make(0, 0, value), t);
+  }
+
+  size_t pop_front(size_t t) {
+    node n = nodes[t];
+    return n.left ? make(pop_front(n.left), n.right, n.value) : n.right;
+  }
+
+  size_t pop_back(size_t t) {
+    node n = nodes[t];
+    return n.right ? make(n.left, pop_back(n.right), n.value) : n.left;
+  }
+
+ private:
+  struct node {
+    size_t left;
+    size_t right;
+    value_type value;
+    uint64_t priority;
+  };
+
+  struct node_hash {
+    size_t operator()(const std::tuple<size_t, size_t, value_type>& n) const {
+      auto& [left, right, value] = n;
+      return placed_hash(value, placed_hash(left, right));
+    }
+  };
+
+  bool above(size_t a, size_t b) const {
+    return nodes[a].priority > nodes[b].priority ||
+           (nodes[a].priority == nodes[b].priority &&
+            nodes[a].value < nodes[b].value);
+  }
+
+  size_t merge(size_t a, size_t b) {
+    if (!a || !b) return a | b;
+    if (above(a, b)) {
+      node n = nodes[a];
+      return make(n.left, merge(n.right, b), n.value);
+    }
+    node n = nodes[b];
+    return make(merge(a, n.left), n.right, n.value);
+  }
+
+  size_t make(size_t left, size_t right, const value_type& value) {
+    auto [iter, inserted] = ids.try_emplace({left, right, value}, nodes.size());
+    if (inserted)
+      nodes.push_back({left, right, value, placed_hash(value, 0)});
+    return iter->second;
+  }
+
+  // the empty sequence first
+  std::vector<node> nodes{node{}};
+  std::unordered_map<std::tuple<size_t, size_t, value_type>, size_t, node_hash>
+      ids;
+};
+
+template <typename value_type>
+struct set_spec {
+ public:
+  explicit set_spec(const value_type&) {}
+
+  bool apply(Method method, const value_type& value) {
+    switch (method) {
+      case Method::INSERT:
+        if (!added.insert(value).second) return false;
+        values.insert(value);
+        if (missed.count(value)) --missedNeverAdded;
+        return true;
+      case Method::REMOVE:
+        return values.erase(value);
+      case Method::CONTAINS_TRUE:
+        return values.count(value);
+      case Method::CONTAINS_FALSE:
+        if (values.count(value)) return false;
+        if (!added.count(value) && !missed[value]++) ++missedNeverAdded;
+        return true;
+      default:
+        return false;
+    }
+  }
+
+  void undo(Method method, const value_type& value) {
+    switch (method) {
+      case Method::INSERT:
+        added.erase(value);
+        values.erase(value);
+        if (missed.count(value)) ++missedNeverAdded;
+        break;
+      case Method::REMOVE:
+        values.insert(value);
+        break;
+      case Method::CONTAINS_FALSE:
+        if (!added.count(value) && !--missed[value]) {
+          missed.erase(value);
+          --missedNeverAdded;
+        }
+        break;
+      default:
+        break;
+    }
+  }
+
+  bool finish() const { return !missedNeverAdded; }
+
+  size_t state() const { return 0; }
+
+ private:
+  std::unordered_set<value_type> added;
+  std::unordered_set<value_type> values;
+  // `contains_false` applied before the value was added, per value
+  std::unordered_map<value_type, size_t> missed;
+  size_t missedNeverAdded = 0;
+};
+
+template <typename value_type>
+struct stack_spec {
+ public:
+  explicit stack_spec(const value_type& emptyVal) : emptyVal(emptyVal) {}
+
+  bool apply(Method method, const value_type& value) {
+    switch (method) {
+      case Method::PUSH:
+        if (!added.insert(value).second) return false;
+        top = interned.push(top, value);
+        values.push_back(value);
+        return true;
+      case Method::POP:
+        if (values.empty()) return value == emptyVal;
+        if (values.back() != value) return false;
+        values.pop_back();
+        top = interned.pop(top);
+        return true;
+      case Method::PEEK:
+        return values.empty() ? value == emptyVal : values.back() == value;
+      default:
+        return false;
+    }
+  }
+
+  void undo(Method method, const value_type& value) {
+    if (method == Method::PUSH) {
+      added.erase(value);
+      values.pop_back();
+      top = interned.pop(top);
+    } else if (method == Method::POP && value != emptyVal) {
+      top = interned.push(top, value);
+      values.push_back(value);
+    }
+  }
+
+  bool finish() const { return true; }
+
+  size_t state() const { return top; }
+
+ private:
+  value_type emptyVal;
+  std::unordered_set<value_type> added;
+  std::vector<value_type> values;
+  interned_stack<value_type> interned;
+  size_t top = 0;
+};
+
+template <typename value_type>
+struct queue_spec {
+ public:
+  explicit queue_spec(const value_type& emptyVal) : emptyVal(emptyVal) {}
+
+  bool apply(Method method, const value_type& value) {
+    switch (method) {
+      case Method::ENQ:
+        if (!added.insert(value).second) return false;
+        contents = interned.push_back(contents, value);
+        values.push_back(value);
+        return true;
+      case Method::DEQ:
+        if (values.empty()) return value == emptyVal;
+        if (values.front() != value) return false;
+        values.pop_front();
+        contents = interned.pop_front(contents);
+        return true;
+      case Method::PEEK:
+        return values.empty() ? value == emptyVal : values.front() == value;
+      default:
+        return false;
+    }
+  }
+
+  void undo(Method method, const value_type& value) {
+    if (method == Method::ENQ) {
+      added.erase(value);
+      values.pop_back();
+      contents = interned.pop_back(contents);
+    } else if (method == Method::DEQ && value != emptyVal) {
+      contents = interned.push_front(contents, value);
+      values.push_front(value);
+    }
+  }
+
+  bool finish() const { return true; }
+
+  size_t state() const { return contents; }
+
+ private:
+  value_type emptyVal;
+  std::unordered_set<value_type> added;
+  std::deque<value_type> values;
+  interned_sequence<value_type> interned;
+  size_t contents = 0;
+};
+
+// polls and peeks the largest value
+template <typename value_type>
+struct priorityqueue_spec {
+ public:
+  explicit priorityqueue_spec(const value_type& emptyVal)
+      : emptyVal(emptyVal) {}
+
+  bool apply(Method method, const value_type& value) {
+    switch (method) {
+      case Method::INSERT:
+        if (!added.insert(value).second) return false;
+        values.insert(value);
+        return true;
+      case Method::POLL:
+        if (values.empty()) return value == emptyVal;
+        if (*values.rbegin() != value) return false;
+        values.erase(std::prev(values.end()));
+        return true;
+      case Method::PEEK:
+        return values.empty() ? value == emptyVal : *values.rbegin() == value;
+      default:
+        return false;
+    }
+  }
+
+  void undo(Method method, const value_type& value) {
+    if (method == Method::INSERT) {
+      added.erase(value);
+      values.erase(value);
+    } else if (method == Method::POLL && value != emptyVal) {
+      values.insert(value);
+    }
+  }
+
+  bool finish() const { return true; }
+
+  size_t state() const { return 0; }
+
+ private:
+  value_type emptyVal;
+  std::unordered_set<value_type> added;
+  std::set<value_type> values;
+};
+
+template <typename value_type>
+struct counter_spec {
+ public:
+  explicit counter_spec(const value_type&) {}
+
+  bool apply(Method method, const value_type& value) {
+    switch (method) {
+      case Method::FETCH_ADD:
+        if (value != count) return false;
+        ++count;
+        return true;
+      case Method::READ:
+        return value == count;
+      default:
+        return false;
+    }
+  }
+
+  void undo(Method method, const value_type&) {
+    if (method == Method::FETCH_ADD) --count;
+  }
+
+  bool finish() const { return true; }
+
+  size_t state() const { return 0; }
+
+ private:
+  value_type count = 0;
+};
+
+}  // namespace fastlin
@@ -0,0 +1,114 @@
+#pragma once
+
+#include <pthread.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+#include "commons/parallel.h"
+#include "commons/thread_pool.h"
+
+namespace fastlin {
+
+inline volatile sig_atomic_t serverStopping = 0;
+
+// largest request accepted, in bytes
+inline size_t serve_max_request = size_t{1} << 28;
+
+// how long a connection may stall while sending its request or reading the
+// reply, so that it cannot hold a worker, and with it shutdown, forever
+inline long serve_io_timeout_secs = 30;
+
+/**
+ * Serves requests over a Unix domain socket at `path` until SIGINT/SIGTERM.
+ * A client writes its request, shuts down its writing end and reads the
+ * reply until the connection is closed. Connections are handled concurrently
+ * on `workers` long-lived threads; `handler` maps a request to its reply and
+ * exceptions it throws are replied as `error <message>`, as are requests over
+ * `serve_max_request` bytes or stalling for `serve_io_timeout_secs`.
+ */
+template <typename handler_t>
+void serve_unix_socket(const std::string& path, size_t workers,
+                       handler_t handler) {
+  sockaddr_un addr{};
+  addr.sun_family = AF_UNIX;
+  if (path.size() >= sizeof(addr.sun_path))
+    throw std::invalid_argument("Socket path too long: " + path);
+  std::strcpy(addr.sun_path, path.c_str());
+
+  int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+  unlink(path.c_str());
+  if (fd < 0 || bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) ||
+      listen(fd, SOMAXCONN))
+    throw std::runtime_error("Cannot listen on " + path + ": " +
+                             std::strerror(errno));
+
+  // no SA_RESTART so that `accept` returns once asked to stop
+  struct sigaction stop {};
+  stop.sa_handler = [](int) { serverStopping = 1; };
+  sigaction(SIGINT, &stop, nullptr);
+  sigaction(SIGTERM, &stop, nullptr);
+  signal(SIGPIPE, SIG_IGN);
+
+  // workers inherit a mask blocking the stop signals, so that the kernel
+  // delivers them to this thread and they interrupt `accept`
+  sigset_t stopSignals;
+  sigemptyset(&stopSignals);
+  sigaddset(&stopSignals, SIGINT);
+  sigaddset(&stopSignals, SIGTERM);
+  pthread_sigmask(SIG_BLOCK, &stopSignals, nullptr);
+
+  {
+    thread_pool pool{workers};
+    pthread_sigmask(SIG_UNBLOCK, &stopSignals, nullptr);
+    while (!serverStopping) {
+      int conn = accept(fd, nullptr, nullptr);
+      if (conn < 0) continue;
+      timeval timeout{serve_io_timeout_secs, 0};
+      setsockopt(conn, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+      setsockopt(conn, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+      pool.submit([conn, &handler] {
+        // requests are checked concurrently already, their passes run inline
+        in_parallel = true;
+        std::string request, reply;
+        char buf[1 << 16];
+        ssize_t len = 0;
+        while (request.size() <= serve_max_request &&
+               (len = read(conn, buf, sizeof(buf))) > 0)
+          request.append(buf, len);
+        try {
+          if (request.size() > serve_max_request)
+            throw std::length_error("Request larger than " +
+                                    std::to_string(serve_max_request) +
+                                    " bytes");
+          if (len < 0)
+            throw std::runtime_error(
+                errno == EAGAIN || errno == EWOULDBLOCK
+                    ? "Request not finished within " +
+                          std::to_string(serve_io_timeout_secs) + " seconds"
+                    : std::string(std::strerror(errno)));
+          reply = handler(request);
+        } catch (const std::exception& e) {
+          reply = std::string("error ") + e.what() + "\n";
+        }
+        for (size_t sent = 0; sent < reply.size(); sent += len)
+          if ((len = write(conn, reply.data() + sent, reply.size() - sent)) <=
+              0)
+            break;
+        close(conn);
+      });
+    }
+  }  // lets pending connections finish
+
+  close(fd);
+  unlink(path.c_str());
+}
+
+}  // namespace fastlin
@@ -0,0 +1,187 @@
+#pragma once
+
+#include <unistd.h>
+
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "definitions.h"
+
+namespace fastlin {
+
+// 128-bit digest of the parsed operations together with the data type and the
+// flags that affect the verdict, so that formatting, comments and text versus
+// binary input do not matter. Each 64-bit word is folded into two lanes
+// through the splitmix64 finalizer, so that every bit of a word reaches every
+// bit of both lanes.
+struct history_digest {
+ public:
+  history_digest(const std::string& type, bool exclude_peeks) {
+    add(type.size());
+    for (char c : type) add(static_cast<unsigned char>(c));
+    add(exclude_peeks);
+  }
+
+  void add(uint64_t word) {
+    lo = mix(lo ^ word);
+    hi = mix(hi ^ lo ^ std::rotl(word, 29));
+  }
+
+  // Stands in for a history while reading, digesting each operation before
+  // passing it on
+  template <typename history_type>
+  struct sink {
+    history_type& hist;
+    history_digest& digest;
+
+    template <typename value_type>
+    void emplace_back(id_type id, Method method, const value_type& value,
+                      time_type startTime, time_type endTime) {
+      digest.add(method);
+      digest.add(std::hash<value_type>{}(value));
+      digest.add(startTime);
+      digest.add(endTime);
+      hist.emplace_back(id, method, value, startTime, endTime);
+    }
+
+    size_t size() const { return hist.size(); }
+  };
+
+  template <typename history_type>
+  sink<history_type> into(history_type& hist) {
+    return {hist, *this};
+  }
+
+  std::string key() const {
+    char buf[33];
+    std::snprintf(buf, sizeof(buf), "%016llx%016llx",
+                  static_cast<unsigned long long>(hi),
+                  static_cast<unsigned long long>(lo));
+    return buf;
+  }
+
+ private:
+  static uint64_t mix(uint64_t x) {
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+    return x ^ (x >> 31);
+  }
+
+  uint64_t lo = 0x9e3779b97f4a7c15ULL;
+  uint64_t hi = 0x6a09e667f3bcc909ULL;
+};
+
+// `$XDG_CACHE_HOME/fastlin`, else `$HOME/.cache/fastlin`, else none
+inline std::string default_cache_dir() {
+  if (const char* xdg = std::getenv("XDG_CACHE_HOME"); xdg && *xdg)
+    return std::string(xdg) + "/fastlin";
+  if (const char* home = std::getenv("HOME"); home && *home)
+    return std::string(home) + "/.cache/fastlin";
+  return "";
+}
+
+/**
+ * Verdicts of past checks, one file per history digest, keeping at most
+ * `max_entries` of the most recently used, plus those stored since the last
+ * eviction. Failing to read or write the cache
+ * never fails a check, and concurrent processes may share a directory.
+ */
+struct verdict_cache {
+ public:
+  struct entry {
+    bool result;
+    long long time_micros;
+    size_t operations;
+    size_t pruned;
+  };
+
+  // an empty `dir` disables the cache
+  verdict_cache(const std::string& dir, size_t max_entries)
+      : dir(dir), max_entries(max_entries) {}
+
+  std::optional<entry> lookup(const history_digest& digest,
+                              size_t operations) const {
+    if (dir.empty()) return std::nullopt;
+    std::filesystem::path path = dir / digest.key();
+    std::ifstream f(path);
+    std::string magic;
+    entry e;
+    if (!(f >> magic >> e.result >> e.time_micros >> e.operations >>
+          e.pruned) ||
+        magic != MAGIC || e.operations != operations)
+      return std::nullopt;
+
+    std::error_code ec;
+    std::filesystem::last_write_time(
+        path, std::filesystem::file_time_type::clock::now(), ec);
+    return e;
+  }
+
+  void store(const history_digest& digest, const entry& e) const {
+    if (dir.empty() || !max_entries) return;
+    std::error_code ec;
+    std::filesystem::create_directories(dir, ec);
+
+    // written aside and renamed, so that readers never see a partial entry
+    std::filesystem::path path = dir / digest.key();
+    std::filesystem::path tmp = path;
+    tmp += ".tmp" + std::to_string(getpid());
+    {
+      std::ofstream f(tmp);
+      f << MAGIC << " " << e.result << " " << e.time_micros << " "
+        << e.operations << " " << e.pruned << "\n";
+      if (!f) return;
+    }
+    std::filesystem::rename(tmp, path, ec);
+    if (ec) std::filesystem::remove(tmp, ec);
+    if (due_for_eviction()) evict();
+  }
+
+ private:
+  static constexpr const char* MAGIC = "fastlin-verdict-3";
+  // not a digest, so never taken for an entry
+  static constexpr const char* STORES = "stores";
+
+  // Counts stores in the directory itself, as each check runs in a process of
+  // its own, and is due every sixteenth of `max_entries` so that walking the
+  // directory stays O(1) per store amortized. Stores lost to concurrent
+  // processes only delay eviction.
+  bool due_for_eviction() const {
+    std::filesystem::path path = dir / STORES;
+    size_t stores = 0;
+    std::ifstream(path) >> stores;
+    bool due = ++stores > max_entries / 16;
+    std::ofstream(path) << (due ? 0 : stores) << "\n";
+    return due;
+  }
+
+  // drops the least recently used entries beyond `max_entries`
+  void evict() const {
+    std::error_code ec;
+    std::vector<std::pair<std::filesystem::file_time_type,
+                          std::filesystem::path>>
+        entries;
+    for (const auto& file : std::filesystem::directory_iterator(dir, ec))
+      if (file.path().filename() != STORES)
+        entries.emplace_back(file.last_write_time(ec), file.path());
+    if (entries.size() <= max_entries) return;
+
+    std::sort(entries.begin(), entries.end());
+    for (size_t i = 0; i < entries.size() - max_entries; ++i)
+      std::filesystem::remove(entries[i].second, ec);
+  }
+
+  std::filesystem::path dir;
+  size_t max_entries;
+};
+
+}  // namespace fastlin
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <algorithm>
+#include <istream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "history_columns.h"
+#include "sequential_spec.h"
+
+namespace fastlin {
+
+/**
+ * A witness is a claimed linearization: the ids of all operations, i.e. their
+ * row numbers from 1, in the order they took effect, separated by whitespace.
+ * Lines starting with `#` are ignored.
+ */
+inline std::vector<id_type> read_witness(std::istream& in) {
+  std::vector<id_type> order;
+  std::string line;
+  while (std::getline(in, line)) {
+    if (!line.empty() && line[0] == '#') continue;
+    std::istringstream ss{line};
+    for (id_type id; ss >> id;) order.push_back(id);
+    if (!ss.eof()) throw std::invalid_argument("Malformed witness: " + line);
+  }
+  return order;
+}
+
+/**
+ * Checks in one pass that `order` lists every operation of an unprocessed
+ * `hist` (`history_t` or `history_columns`) once, respects real-time order
+ * and is accepted by `spec_type`, O(n) expected.
+ */
+template <template <typename> typename spec_type, typename history_type,
+          typename value_type>
+bool check_witness(const history_type& hist, const std::vector<id_type>& order,
+                   const value_type& emptyVal) {
+  if (order.size() != hist.size()) return false;
+
+  // ids are row numbers, so that the operation with id `i` is at `i - 1`
+  std::vector<bool> seen(hist.size() + 1, false);
+  spec_type<value_type> spec{emptyVal};
+  time_type maxStart = MIN_TIME;
+  for (id_type id : order) {
+    if (!id || id > hist.size() || seen[id]) return false;
+    seen[id] = true;
+    size_t i = id - 1;
+
+    // an operation cannot take effect before one that was invoked after it
+    // responded, responses coming first at equal times
+    if (end_at(hist, i) <= maxStart) return false;
+    maxStart = std::max(maxStart, start_at(hist, i));
+    if (!spec.apply(method_at(hist, i), value_at(hist, i))) return false;
+  }
+  return spec.finish();
+}
+
+template <typename history_type, typename value_type>
+bool check_witness(const std::string& type, const history_type& hist,
+                   const std::vector<id_type>& order,
+                   const value_type& emptyVal) {
+#define SUPPORT_DS(TYPE) \
+  if (type == #TYPE) return check_witness<TYPE##_spec>(hist, order, emptyVal);
+  SUPPORT_DS(set);
+  SUPPORT_DS(stack);
+  SUPPORT_DS(queue);
+  SUPPORT_DS(priorityqueue);
+  SUPPORT_DS(counter);
+#undef SUPPORT_DS
+  throw std::invalid_argument("Unknown data type");
+}
+
+}  // namespace fastlin
@@ -1,15 +1,34 @@
 #include <getopt.h>
 #include <unistd.h>
 
+#include <algorithm>
 #include <chrono>
+#include <condition_variable>
+#include <fstream>
 #include <iostream>
 #include <memory>
+#include <mutex>
+#include <sstream>
+#include <thread>
+#include <type_traits>
 
+#include "algo/counter_lin.h"
 #include "algo/priorityqueue_lin.h"
 #include "algo/queue_lin.h"
 #include "algo/set_lin.h"
 #include "algo/stack_lin.h"
+#include "checkpoint.h"
+#include "commons/perf_counters.h"
+#include "history_columns.h"
 #include "history_reader.h"
+#include "history_stats.h"
+#include "locate.h"
+#include "planner.h"
+#include "prefilter.h"
+#include "search.h"
+#include "server.h"
+#include "verdict_cache.h"
+#include "witness.h"
 
 using namespace fastlin;
 
@@ -19,6 +38,78 @@ typedef std::chrono::steady_clock hr_clock;
 typedef long long default_value_type;
 const long long defaultEmptyVal = -1;
 
+// same as coreutils `timeout`, so that batch jobs can reschedule
+const int EXIT_TIMEOUT = 124;
+
+enum long_option {
+  OPT_HELP = 256,
+  OPT_CHECKPOINT,
+  OPT_WATCH,
+  OPT_TIMEOUT,
+  OPT_PROGRESS,
+  OPT_SERVE,
+  OPT_STATS,
+  OPT_MEMORY,
+  OPT_NO_CACHE,
+  OPT_CACHE_DIR,
+  OPT_CACHE_SIZE,
+  OPT_WITNESS,
+  OPT_PERF_COUNTERS,
+  OPT_ENGINE,
+  OPT_LOCATE,
+  OPT_EVENTS
+};
+
+// Prints the status of `fastlin::progress` to stderr every `interval` seconds
+// and cancels the check after `timeout` seconds, `0` disabling either
+struct watchdog {
+ public:
+  watchdog(double timeout, double interval) {
+    if (timeout <= 0 && interval <= 0) return;
+    thread = std::thread([=, this] {
+      auto start = hr_clock::now();
+      auto deadline = timeout > 0 ? start + to_duration(timeout)
+                                  : hr_clock::time_point::max();
+      auto nextReport = interval > 0 ? start + to_duration(interval)
+                                     : hr_clock::time_point::max();
+      std::unique_lock lock{mtx};
+      while (!done) {
+        auto now = hr_clock::now();
+        if (now >= deadline) {
+          progress.cancel();
+          return;
+        }
+        if (now >= nextReport) {
+          std::cerr << progress.status() << std::endl;
+          nextReport += to_duration(interval);
+        }
+        cv.wait_until(lock, std::min(deadline, nextReport));
+      }
+    });
+  }
+
+  ~watchdog() {
+    if (!thread.joinable()) return;
+    {
+      std::lock_guard lock{mtx};
+      done = true;
+    }
+    cv.notify_one();
+    thread.join();
+  }
+
+ private:
+  static hr_clock::duration to_duration(double secs) {
+    return std::chrono::duration_cast<hr_clock::duration>(
+        std::chrono::duration<double>(secs));
+  }
+
+  std::thread thread;
+  std::mutex mtx;
+  std::condition_variable cv;
+  bool done = false;
+};
+
 template <typename value_type>
 auto get_monitor(const std::string& type, bool exclude_peeks) {
 #define SUPPORT_DS(TYPE)                                       \
@@ -29,27 +120,71 @@ auto get_monitor(const std::string& type, bool exclude_peeks) {
   SUPPORT_DS(stack);
   SUPPORT_DS(queue);
   SUPPORT_DS(priorityqueue);
+  SUPPORT_DS(counter);
 #undef SUPPORT_DS
   throw std::invalid_argument("Unknown data type");
 }
 
 void print_usage() {
   std::cout
-      << "Usage: ./fastlin [-txvh] <history_file>\n"
+      << "Usage: ./fastlin [-txvh] [-j threads] "
+         "<history_file... | manifest | ->\n"
       << "Options:\n"
       << "  -t\treport time taken in seconds\n"
       << "  -x\texclude peek operations (chooses faster algo if possible)\n"
       << "  -v\tprint verbose information\n"
-      << "  -h\tinclude headers\n";
+      << "  -h\tinclude headers\n"
+      << "  -j\tnumber of worker threads (defaults to hardware threads)\n"
+      << "  --checkpoint <file>\tonly check rows appended since the state "
+         "saved in <file>\n"
+      << "  --watch <seconds>\tre-check appended rows periodically\n"
+      << "  --timeout <seconds>\tgive up after <seconds>, exiting with status "
+      << EXIT_TIMEOUT << "\n"
+      << "  --progress <seconds>\tprint the current phase to stderr every "
+         "<seconds>\n"
+      << "  --serve <socket>\tcheck histories sent over a Unix domain "
+         "socket\n"
+      << "  --stats\treport the shape of the history instead of checking it\n"
+      << "  --memory <MiB>\tspill large arrays to $TMPDIR beyond <MiB>\n"
+      << "  --no-cache\talways check, without reading or storing verdicts\n"
+      << "  --cache-dir <dir>\tstore verdicts in <dir> (defaults to "
+         "~/.cache/fastlin)\n"
+      << "  --cache-size <entries>\tkeep at most <entries> verdicts\n"
+      << "  --witness <file>\ttry the linearization listed in <file> "
+         "first\n"
+      << "  --perf-counters\treport hardware counters of each phase to "
+         "stderr\n"
+      << "  --engine <name>\tcheck with auto, standard, no-peeks, replay or "
+         "search\n"
+      << "  --locate\treport when a violation first shows, and the operations "
+         "involved\n"
+      << "  --events <type>\tread a log of invoke and ok/fail/info events of "
+         "<type>\n";
 }
 
 int main(int argc, char* argv[]) {
-  const char* titles[]{"result", "time_taken", "operations", "exclude_peeks"};
-  bool to_print[]{true, false, false, false};
-  auto& [_, print_time, print_size, print_xpeeks] = to_print;
+  const char* titles[]{"result", "time_taken", "operations", "exclude_peeks",
+                       "pruned"};
+  bool to_print[]{true, false, false, false, false};
+  auto& [_, print_time, print_size, print_xpeeks, print_pruned] = to_print;
   bool print_header = false;
+  bool verbose = false;
   bool exclude_peeks = false;
-  std::string input_file;
+  std::vector<std::string> input_files;
+  std::string checkpoint_file;
+  long watch_secs = 0;
+  double timeout_secs = 0;
+  double progress_secs = 0;
+  std::string socket_path;
+  bool print_stats = false;
+  bool use_cache = true;
+  std::string cache_dir = default_cache_dir();
+  size_t cache_entries = 10000;
+  std::string witness_file;
+  bool perf = false;
+  engine forced_engine = engine::AUTO;
+  bool locate_violation = false;
+  std::string events_type;
 
   if (argc <= 1) {
     print_usage();
@@ -58,14 +193,80 @@ int main(int argc, char* argv[]) {
 
   int flag;
   int long_optind;
-  static struct option long_options[] = {{"help", no_argument, 0, 0},
-                                         {0, 0, 0, 0}};
-  while ((flag = getopt_long(argc, argv, "txvh", long_options, &long_optind)) !=
+  static struct option long_options[] = {
+      {"help", no_argument, 0, OPT_HELP},
+      {"checkpoint", required_argument, 0, OPT_CHECKPOINT},
+      {"watch", required_argument, 0, OPT_WATCH},
+      {"timeout", required_argument, 0, OPT_TIMEOUT},
+      {"progress", required_argument, 0, OPT_PROGRESS},
+      {"serve", required_argument, 0, OPT_SERVE},
+      {"stats", no_argument, 0, OPT_STATS},
+      {"memory", required_argument, 0, OPT_MEMORY},
+      {"no-cache", no_argument, 0, OPT_NO_CACHE},
+      {"cache-dir", required_argument, 0, OPT_CACHE_DIR},
+      {"cache-size", required_argument, 0, OPT_CACHE_SIZE},
+      {"witness", required_argument, 0, OPT_WITNESS},
+      {"perf-counters", no_argument, 0, OPT_PERF_COUNTERS},
+      {"engine", required_argument, 0, OPT_ENGINE},
+      {"locate", no_argument, 0, OPT_LOCATE},
+      {"events", required_argument, 0, OPT_EVENTS},
+      {0, 0, 0, 0}};
+  while ((flag = getopt_long(argc, argv, "txvhj:", long_options, &long_optind)) !=
          -1)
     switch (flag) {
-      case 0:
+      case OPT_HELP:
         print_usage();
         exit(EXIT_SUCCESS);
+      case OPT_CHECKPOINT:
+        checkpoint_file = optarg;
+        break;
+      case OPT_WATCH:
+        watch_secs = std::stol(optarg);
+        break;
+      case OPT_TIMEOUT:
+        timeout_secs = std::stod(optarg);
+        break;
+      case OPT_PROGRESS:
+        progress_secs = std::stod(optarg);
+        break;
+      case OPT_SERVE:
+        socket_path = optarg;
+        break;
+      case OPT_STATS:
+        print_stats = true;
+        break;
+      case OPT_MEMORY:
+        memory_budget = std::stoull(optarg) << 20;
+        break;
+      case OPT_NO_CACHE:
+        use_cache = false;
+        break;
+      case OPT_CACHE_DIR:
+        cache_dir = optarg;
+        break;
+      case OPT_CACHE_SIZE:
+        cache_entries = std::stoull(optarg);
+        break;
+      case OPT_WITNESS:
+        witness_file = optarg;
+        break;
+      case OPT_PERF_COUNTERS:
+        perf = true;
+        break;
+      case OPT_ENGINE:
+        try {
+          forced_engine = parse_engine(optarg);
+        } catch (const std::invalid_argument& e) {
+          std::cerr << e.what() << "\n";
+          exit(EXIT_FAILURE);
+        }
+        break;
+      case OPT_LOCATE:
+        locate_violation = true;
+        break;
+      case OPT_EVENTS:
+        events_type = optarg;
+        break;
       case 't':
         print_time = true;
         break;
@@ -73,48 +274,290 @@ int main(int argc, char* argv[]) {
         exclude_peeks = true;
         break;
       case 'v':
+        verbose = true;
         std::fill(to_print, to_print + sizeof(to_print), true);
         break;
       case 'h':
         print_header = true;
         break;
+      case 'j':
+        thread_count = std::max(1, std::stoi(optarg));
+        break;
       case '?':
         std::cerr << "Unknown option `" << optopt << "'.\n";
         exit(EXIT_FAILURE);
       default:
         abort();
     }
+
+  auto format_result = [&](bool result, long long time_micros,
+                           size_t operations, size_t pruned) {
+    std::ostringstream out;
+    if (print_header) {
+      for (size_t i = 0; i < sizeof(to_print); ++i)
+        if (to_print[i]) out << titles[i] << " ";
+      out << "\n";
+    }
+
+    out << result << " ";
+    if (print_time) out << (time_micros / 1e6) << " ";
+    if (print_size) out << operations << " ";
+    if (print_xpeeks) out << (exclude_peeks ? "true" : "false") << " ";
+    if (print_pruned) out << pruned << " ";
+    out << "\n";
+    return out.str();
+  };
+
+  if (!socket_path.empty()) {
+    // cancellation is process-wide, while requests are checked concurrently
+    if (timeout_secs > 0) {
+      std::cerr << "--timeout does not apply to --serve\n";
+      exit(EXIT_FAILURE);
+    }
+    print_time = true;
+    auto check_request = [&](const std::string& request) {
+      std::istringstream in{request};
+      history_t<default_value_type> hist;
+      std::string histType = history_reader<default_value_type>::read(in, hist);
+      auto monitor = get_monitor<default_value_type>(histType, exclude_peeks);
+      size_t operations = hist.size();
+
+      hr_clock::time_point start = hr_clock::now();
+      pruned_ops = 0;
+      bool result = monitor(hist, defaultEmptyVal);
+      hr_clock::time_point end = hr_clock::now();
+      return format_result(
+          result,
+          std::chrono::duration_cast<std::chrono::microseconds>(end - start)
+              .count(),
+          operations, pruned_ops);
+    };
+    serve_unix_socket(socket_path, thread_count, check_request);
+    return 0;
+  }
+
   if (optind < argc)
-    input_file = argv[optind];
+    input_files.assign(argv + optind, argv + argc);
   else {
     std::cout << "Please provide a file path\n";
     exit(EXIT_FAILURE);
   }
 
-  history_reader<default_value_type> reader(input_file);
-  std::string histType = reader.get_type_s();
-  auto monitor = get_monitor<default_value_type>(histType, exclude_peeks);
-  auto hist = reader.get_hist();
-  size_t operations = hist.size();
-
-  hr_clock::time_point start = hr_clock::now();
-  bool result = monitor(hist, defaultEmptyVal);
-  hr_clock::time_point end = hr_clock::now();
-  long long time_micros =
-      std::chrono::duration_cast<std::chrono::microseconds>(end - start)
-          .count();
-
-  if (print_header) {
-    for (size_t i = 0; i < sizeof(to_print); ++i)
-      if (to_print[i]) std::cout << titles[i] << " ";
-    std::cout << "\n";
+  auto print_result = [&](bool result, long long time_micros,
+                          size_t operations, size_t pruned) {
+    std::cout << format_result(result, time_micros, operations, pruned)
+              << std::flush;
+    print_header = false;
+  };
+
+  if (perf && !phase_counters.open()) {
+    std::cerr << "Performance counters unavailable, ignoring --perf-counters\n";
+    perf = false;
   }
+  if (perf) progress.observe([](const char* name) {
+    phase_counters.enter(name);
+  });
 
-  std::cout << result << " ";
-  if (print_time) std::cout << (time_micros / 1e6) << " ";
-  if (print_size) std::cout << operations << " ";
-  if (print_xpeeks) std::cout << (exclude_peeks ? "true" : "false") << " ";
-  std::cout << std::endl;
+  watchdog dog{timeout_secs, progress_secs};
+  try {
+    // per-thread logs, given one by one or listed by a manifest
+    if (input_files.size() == 1 && input_files[0] != "-" &&
+        events_type.empty()) {
+      auto listed = history_reader<default_value_type>::read_manifest(
+          input_files[0]);
+      if (!listed.empty()) input_files = listed;
+    }
+    const std::string& input_file = input_files[0];
+    bool from_stdin = input_file == "-";
+    if (input_files.size() > 1 &&
+        std::count(input_files.begin(), input_files.end(), "-")) {
+      std::cerr << "- cannot be read along with other files\n";
+      exit(EXIT_FAILURE);
+    }
+    if ((from_stdin || input_files.size() > 1) &&
+        (!checkpoint_file.empty() || watch_secs > 0)) {
+      std::cerr << "--checkpoint and --watch need a single history file\n";
+      exit(EXIT_FAILURE);
+    }
+    // processes and arrival order span the whole log
+    if (!events_type.empty() && (input_files.size() > 1 ||
+                                 !checkpoint_file.empty() || watch_secs > 0)) {
+      std::cerr << "--events needs a single log, checked as a whole\n";
+      exit(EXIT_FAILURE);
+    }
+
+    if (!checkpoint_file.empty() || watch_secs > 0) {
+      history_reader<default_value_type> reader(input_file);
+      std::string histType = reader.get_type_s();
+      // values returned after a cut depend on every operation before it
+      if (histType == "counter") {
+        std::cerr << "--checkpoint and --watch do not support counter "
+                     "histories\n";
+        exit(EXIT_FAILURE);
+      }
+      auto monitor = get_monitor<default_value_type>(histType, exclude_peeks);
+      checkpoint<default_value_type> state(histType, exclude_peeks);
+      if (!checkpoint_file.empty()) state.load(checkpoint_file);
+      while (true) {
+        hr_clock::time_point start = hr_clock::now();
+        pruned_ops = 0;
+        bool result = state.advance(reader, defaultEmptyVal, monitor);
+        hr_clock::time_point end = hr_clock::now();
+        if (!checkpoint_file.empty()) state.save(checkpoint_file);
+        print_result(result,
+                     std::chrono::duration_cast<std::chrono::microseconds>(
+                         end - start)
+                         .count(),
+                     state.operations(), pruned_ops);
+        if (watch_secs <= 0) return 0;
+        std::this_thread::sleep_for(std::chrono::seconds(watch_secs));
+      }
+    }
+
+    std::ifstream file;
+    if (!from_stdin) {
+      file.open(input_file);
+      if (!file) {
+        std::cerr << "Cannot open " << input_file << "\n";
+        exit(EXIT_FAILURE);
+      }
+    } else {
+      std::ios::sync_with_stdio(false);
+    }
+    std::istream& in = from_stdin ? std::cin : file;
+
+    progress.phase("read");
+    bool binary = false;
+    std::string histType =
+        events_type.empty()
+            ? history_reader<default_value_type>::read_header(in, binary)
+            : events_type;
+
+    std::vector<id_type> witness;
+    if (!witness_file.empty()) {
+      std::ifstream f(witness_file);
+      if (!f) {
+        std::cerr << "Cannot open " << witness_file << "\n";
+        exit(EXIT_FAILURE);
+      }
+      witness = read_witness(f);
+    }
+
+    // a cached verdict would leave no phases to measure, nor history to
+    // locate a violation in
+    verdict_cache cache{
+        use_cache && !perf && !locate_violation ? cache_dir : "",
+        cache_entries};
+    auto run = [&](auto& hist, auto standard, auto noPeeks) {
+      history_digest digest{histType, exclude_peeks};
+      auto sink = digest.into(hist);
+      if (events_type.empty())
+        history_reader<default_value_type>::read_rows(in, sink, binary);
+      else
+        history_reader<default_value_type>::read_events(in, sink,
+                                                        defaultEmptyVal);
+      for (size_t i = 1; i < input_files.size(); ++i) {
+        std::ifstream next(input_files[i]);
+        if (!next) {
+          std::cerr << "Cannot open " << input_files[i] << "\n";
+          exit(EXIT_FAILURE);
+        }
+        bool nextBinary;
+        if (history_reader<default_value_type>::read_header(
+                next, nextBinary) != histType)
+          throw std::invalid_argument("Data type of " + input_files[i] +
+                                      " differs from " + input_file);
+        history_reader<default_value_type>::read_rows(next, sink, nextBinary);
+      }
+      size_t operations = hist.size();
+
+      if (print_stats) {
+        history_stats<default_value_type> stats{hist, defaultEmptyVal};
+        if constexpr (std::is_same_v<std::decay_t<decltype(hist)>,
+                                     history_t<default_value_type>>)
+          if (histType == "stack")
+            stats.add_stack_nesting(hist, defaultEmptyVal);
+        stats.print(std::cout);
+        return;
+      }
+
+      if (auto cached = cache.lookup(digest, operations)) {
+        print_result(cached->result, cached->time_micros, operations,
+                     cached->pruned);
+        return;
+      }
+
+      // a rejected witness proves nothing, leaving it to the engine
+      hr_clock::time_point start = hr_clock::now();
+      pruned_ops = 0;
+      // the engines consume the history they check
+      std::optional<std::decay_t<decltype(hist)>> original;
+      if (locate_violation) original = hist;
+      std::optional<violation> found =
+          prefilter(histType, hist, defaultEmptyVal, exclude_peeks);
+      auto check = [&] {
+        plan p = make_plan(histType,
+                           profile_history(histType, hist, defaultEmptyVal),
+                           exclude_peeks, forced_engine);
+        if (verbose) std::cerr << "Plan: " << p.describe() << "\n";
+        switch (p.chosen) {
+          case engine::REPLAY:
+            return replay(histType, hist, defaultEmptyVal);
+          case engine::SEARCH:
+            return search_linearization(histType, hist, defaultEmptyVal);
+          case engine::NO_PEEKS:
+            return noPeeks(hist, defaultEmptyVal);
+          default:
+            return standard(hist, defaultEmptyVal);
+        }
+      };
+      bool result =
+          !found &&
+          ((!witness_file.empty() &&
+            check_witness(histType, hist, witness, defaultEmptyVal)) ||
+           check());
+      hr_clock::time_point end = hr_clock::now();
+      long long time_micros =
+          std::chrono::duration_cast<std::chrono::microseconds>(end - start)
+              .count();
+
+      cache.store(digest, {result, time_micros, operations, pruned_ops});
+      print_result(result, time_micros, operations, pruned_ops);
+      if (found) {
+        std::cerr << "Not linearizable, " << found->reason << ":";
+        for (id_type id : found->ids) std::cerr << " " << id;
+        std::cerr << "\n";
+      }
+      if (original && !result) {
+        auto monitor =
+            get_monitor<default_value_type>(histType, exclude_peeks);
+        if (auto loc = locate(histType, *original, defaultEmptyVal, monitor)) {
+          std::cout << "Violated at " << loc->time << ":";
+          for (id_type id : loc->ids) std::cout << " " << id;
+          std::cout << "\n";
+        }
+      }
+      if (perf) phase_counters.print(std::cerr, operations);
+    };
+
+    // the set engine only scans a few fields of each operation
+    if (histType == "set") {
+      using columns = history_columns<default_value_type>;
+      columns hist;
+      run(hist, set::is_linearizable<default_value_type, columns>,
+          set::is_linearizable_x<default_value_type, columns>);
+    } else {
+      history_t<default_value_type> hist;
+      run(hist, get_monitor<default_value_type>(histType, false),
+          get_monitor<default_value_type>(histType, true));
+    }
+  } catch (const cancelled_error&) {
+    std::cerr << "Timed out during " << progress.status() << "\n";
+    return EXIT_TIMEOUT;
+  } catch (const std::invalid_argument& e) {
+    std::cerr << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
 
   return 0;
-}
\ No newline at end of file
+}
@@ -0,0 +1,14 @@
+#pragma once
+
+#include <cstdlib>
+#include <iostream>
+
+// Fails the test with the condition and its location unless `cond` holds
+#define CHECK(cond)                                                     \
+  do {                                                                  \
+    if (!(cond)) {                                                      \
+      std::cerr << __FILE__ << ":" << __LINE__ << ": CHECK(" #cond ")" \
+                << " failed\n";                                         \
+      std::exit(1);                                                     \
+    }                                                                   \
+  } while (0)
@@ -0,0 +1,59 @@
+#include <filesystem>
+
+#include "check.h"
+#include "checkpoint.h"
+
+using namespace fastlin;
+
+typedef long long value_type;
+const value_type emptyVal = -1;
+
+void write(const std::string& path, const std::string& rows,
+           std::ios::openmode mode = std::ios::trunc) {
+  std::ofstream(path, std::ios::out | mode) << rows;
+}
+
+bool advance(checkpoint<value_type>& state, const std::string& path) {
+  history_reader<value_type> reader(path);
+  return state.advance(reader, emptyVal, stack::is_linearizable<value_type>);
+}
+
+// appended rows are folded into the saved verdict
+void test_appended(const std::string& path) {
+  checkpoint<value_type> state("stack", false);
+  write(path, "# stack\npush 1 1 2\npop 1 3 4\n");
+  CHECK(advance(state, path) && state.operations() == 2);
+  write(path, "push 2 5 6\npop 3 7 8\n", std::ios::app);
+  CHECK(!advance(state, path) && state.operations() == 4);
+}
+
+// a file shrunk below the saved offset is checked from the start
+void test_truncated(const std::string& path) {
+  checkpoint<value_type> state("stack", false);
+  write(path, "# stack\npush 1 1 2\npop 1 3 4\npush 2 5 6\npop 2 7 8\n");
+  CHECK(advance(state, path) && state.operations() == 4);
+  write(path, "# stack\npush 1 1 2\npop 2 3 4\n");
+  CHECK(!advance(state, path) && state.operations() == 2);
+  write(path, "# stack\n");
+  CHECK(advance(state, path) && state.operations() == 0);
+}
+
+// a file replaced by one whose rows straddle the saved offset is checked
+// from the start rather than from the middle of a row
+void test_replaced(const std::string& path) {
+  checkpoint<value_type> state("stack", false);
+  write(path, "# stack\npush 1 1 2\n");
+  CHECK(advance(state, path) && state.operations() == 1);
+  write(path, "# stack\npush 10 1 2\npop 10 3 4\n");
+  CHECK(advance(state, path) && state.operations() == 2);
+}
+
+int main() {
+  std::string path = std::filesystem::temp_directory_path() /
+                     ("fastlin-checkpoint-test-" + std::to_string(getpid()));
+  test_appended(path);
+  test_truncated(path);
+  test_replaced(path);
+  std::filesystem::remove(path);
+  return 0;
+}
@@ -0,0 +1,53 @@
+#include "algo/counter_lin.h"
+#include "algo/stack_lin.h"
+#include "check.h"
+#include "locate.h"
+
+using namespace fastlin;
+
+typedef long long value_type;
+const value_type emptyVal = -1;
+
+void test_stack() {
+  history_t<value_type> hist{{1, Method::PUSH, 1, 1, 2},
+                             {2, Method::POP, 1, 3, 4},
+                             {3, Method::PUSH, 2, 5, 6},
+                             {4, Method::POP, 3, 7, 8},
+                             {5, Method::PUSH, 3, 9, 10}};
+  auto found = locate("stack", hist, emptyVal,
+                      stack::is_linearizable<value_type>);
+  CHECK(found && found->time == 8);
+  CHECK((found->ids == std::vector<id_type>{4, 5}));
+
+  hist.resize(3);
+  CHECK(!locate("stack", hist, emptyVal, stack::is_linearizable<value_type>));
+}
+
+// values far past the number of fetch_adds size nothing by themselves
+void test_counter_large_values() {
+  history_t<value_type> hist{{1, Method::FETCH_ADD, 0, 1, 2},
+                             {2, Method::READ, 1000000000000000000, 3, 4}};
+  auto found = locate("counter", hist, emptyVal,
+                      counter::is_linearizable<value_type>);
+  CHECK(found && found->time == 4);
+
+  hist = {{1, Method::FETCH_ADD, 0, 1, 2},
+          {2, Method::FETCH_ADD, 1000000000000000000, 3, 4},
+          {3, Method::READ, 0, 5, 6}};
+  found = locate("counter", hist, emptyVal,
+                 counter::is_linearizable<value_type>);
+  CHECK(found && found->time == 4);
+
+  hist = {{1, Method::FETCH_ADD, 0, 1, 2},
+          {2, Method::READ, 0, 0, 3},
+          {3, Method::FETCH_ADD, 1, 4, 5},
+          {4, Method::READ, 2, 6, 7}};
+  CHECK(!locate("counter", hist, emptyVal,
+                counter::is_linearizable<value_type>));
+}
+
+int main() {
+  test_stack();
+  test_counter_large_values();
+  return 0;
+}
@@ -0,0 +1,108 @@
+#include "check.h"
+#include "monitor.h"
+
+using namespace fastlin;
+
+typedef long long value_type;
+const value_type emptyVal = -1;
+
+// one operation invoked at `start` and responding at `end`
+template <typename monitor_t>
+bool run(monitor_t& monitor, id_type id, Method method, value_type value,
+         time_type start, time_type end) {
+  monitor.on_invoke(id, start);
+  return monitor.on_response(id, method, value, end);
+}
+
+void test_set_linearizable() {
+  set_monitor<value_type> monitor;
+  monitor.on_invoke(1, 1);
+  monitor.on_invoke(2, 2);
+  CHECK(monitor.on_response(2, Method::CONTAINS_TRUE, 5, 4));
+  CHECK(monitor.on_response(1, Method::INSERT, 5, 5));
+  CHECK(run(monitor, 3, Method::REMOVE, 5, 6, 7));
+  CHECK(monitor.tracked() == 1);
+  // value 5 is retired once no running operation was invoked before its
+  // remove responded
+  CHECK(run(monitor, 4, Method::INSERT, 7, 8, 9));
+  CHECK(monitor.tracked() == 1);
+  CHECK(run(monitor, 5, Method::CONTAINS_FALSE, 5, 10, 11));
+  CHECK(monitor.finish());
+}
+
+void test_set_violation() {
+  set_monitor<value_type> monitor;
+  CHECK(run(monitor, 1, Method::INSERT, 1, 1, 2));
+  // 1 is present throughout, which later operations confirm
+  CHECK(run(monitor, 2, Method::CONTAINS_FALSE, 1, 3, 4));
+  CHECK(!run(monitor, 3, Method::INSERT, 9, 5, 6));
+  CHECK(monitor.violated());
+  CHECK(!monitor.finish());
+}
+
+void test_set_double_insert() {
+  set_monitor<value_type> monitor;
+  CHECK(run(monitor, 1, Method::INSERT, 1, 1, 2));
+  CHECK(!run(monitor, 2, Method::INSERT, 1, 3, 4));
+  CHECK(!monitor.finish());
+}
+
+void test_queue_linearizable() {
+  queue_monitor<value_type> monitor{emptyVal};
+  monitor.on_invoke(1, 1);
+  monitor.on_invoke(2, 2);
+  CHECK(monitor.on_response(2, Method::ENQ, 2, 3));
+  CHECK(monitor.on_response(1, Method::ENQ, 1, 4));
+  // either order of the overlapping enqueues linearizes
+  CHECK(run(monitor, 3, Method::DEQ, 2, 5, 6));
+  CHECK(monitor.buffered() == 3);
+  CHECK(run(monitor, 4, Method::DEQ, 1, 7, 8));
+  // quiescent, so the buffer was checked and dropped
+  CHECK(monitor.buffered() == 0);
+  CHECK(run(monitor, 5, Method::DEQ, emptyVal, 9, 10));
+  CHECK(monitor.finish());
+}
+
+void test_queue_violation() {
+  queue_monitor<value_type> monitor{emptyVal};
+  CHECK(run(monitor, 1, Method::ENQ, 1, 1, 2));
+  CHECK(run(monitor, 2, Method::ENQ, 2, 3, 4));
+  CHECK(run(monitor, 3, Method::DEQ, 2, 5, 6));
+  CHECK(!run(monitor, 4, Method::DEQ, 1, 7, 8));
+  CHECK(monitor.violated());
+  CHECK(!monitor.finish());
+}
+
+// a queue never drained is checked as it grows, and a violation shows
+// while values are still enqueued
+void test_queue_backlog() {
+  queue_monitor<value_type> monitor{emptyVal};
+  id_type id = 0;
+  time_type t = 0;
+  CHECK(run(monitor, ++id, Method::ENQ, 0, 1, 2));
+  for (value_type v = 0; v < 100; ++v, t += 4) {
+    CHECK(run(monitor, ++id, Method::ENQ, v + 1, t + 3, t + 4));
+    CHECK(run(monitor, ++id, Method::DEQ, v, t + 5, t + 6));
+  }
+  // 100 is enqueued, then 101 and 102 jump it
+  CHECK(run(monitor, ++id, Method::ENQ, 101, t + 3, t + 4));
+  CHECK(run(monitor, ++id, Method::ENQ, 102, t + 5, t + 6));
+  run(monitor, ++id, Method::DEQ, 101, t + 7, t + 8);
+  // flagged within twice the operations, though the queue never drains
+  id_type shown = id;
+  for (value_type v = 103; !monitor.violated() && id < 2 * shown; ++v) {
+    t += 8;
+    run(monitor, ++id, Method::ENQ, v, t + 1, t + 2);
+  }
+  CHECK(monitor.violated());
+}
+
+int main() {
+  test_set_linearizable();
+  test_set_violation();
+  test_set_double_insert();
+  test_queue_linearizable();
+  test_queue_violation();
+  test_queue_backlog();
+  return 0;
+}
@@ -0,0 +1,63 @@
+#include <mutex>
+#include <set>
+#include <stdexcept>
+
+#include "check.h"
+#include "commons/parallel.h"
+
+using namespace fastlin;
+
+// passes nested in a parallel pass run on the thread of their chunk
+void test_nested() {
+  thread_count = 4;
+  std::mutex mtx;
+  std::set<std::thread::id> threads;
+  std::vector<int> visited(4 * 1000, 0);
+  parallel_for_each(4, [&](size_t outer) {
+    parallel_for(
+        1000,
+        [&](size_t begin, size_t end) {
+          std::lock_guard lock{mtx};
+          threads.insert(std::this_thread::get_id());
+          for (size_t i = begin; i < end; ++i) ++visited[outer * 1000 + i];
+        },
+        1);
+  });
+  CHECK(threads.size() <= thread_count);
+  for (int v : visited) CHECK(v == 1);
+  CHECK(!in_parallel);
+
+  // a later pass is parallel again
+  threads.clear();
+  parallel_for(
+      4,
+      [&](size_t, size_t) {
+        std::lock_guard lock{mtx};
+        threads.insert(std::this_thread::get_id());
+      },
+      1);
+  CHECK(threads.size() == thread_count);
+}
+
+void test_exception() {
+  thread_count = 4;
+  bool thrown = false;
+  try {
+    parallel_for(
+        4,
+        [](size_t begin, size_t) {
+          if (begin == 2) throw std::runtime_error("chunk");
+        },
+        1);
+  } catch (const std::runtime_error&) {
+    thrown = true;
+  }
+  CHECK(thrown);
+  CHECK(!in_parallel);
+}
+
+int main() {
+  test_nested();
+  test_exception();
+  return 0;
+}
@@ -0,0 +1,92 @@
+#include <sys/resource.h>
+
+#include <filesystem>
+#include <set>
+#include <thread>
+#include <tuple>
+
+#include "check.h"
+#include "recorder.h"
+
+using namespace fastlin;
+
+typedef long long value_type;
+
+history_t<value_type> read_back(const std::string& path, std::string& type) {
+  std::ifstream in(path, std::ios::binary);
+  history_t<value_type> hist;
+  type = history_reader<value_type>::read(in, hist);
+  return hist;
+}
+
+// every thread pushes values of its own, each row read back as recorded
+void test_threads(const std::string& path) {
+  const int threads = 4, perThread = 10000;
+  {
+    // rings smaller than a thread's records, so that threads wait on flushes
+    recorder rec{path, "stack", recorder_clock::MONOTONIC, 1 << 10};
+    std::vector<std::thread> workers;
+    for (int t = 0; t < threads; ++t)
+      workers.emplace_back([&, t] {
+        for (int i = 0; i < perThread; ++i) {
+          time_type start = rec.now();
+          rec.record(Method::PUSH, t * perThread + i, start);
+        }
+      });
+    for (auto& w : workers) w.join();
+  }
+
+  std::string type;
+  history_t<value_type> hist = read_back(path, type);
+  CHECK(type == "stack");
+  CHECK(hist.size() == threads * perThread);
+  std::set<value_type> values;
+  std::vector<time_type> lastStart(threads, 0);
+  for (size_t i = 0; i < hist.size(); ++i) {
+    const auto& o = hist[i];
+    CHECK(o.id == i + 1);
+    CHECK(o.method == Method::PUSH);
+    CHECK(o.startTime <= o.endTime);
+    CHECK(values.insert(o.value).second);
+    // each thread's ring is written out in the order it recorded
+    size_t t = o.value / perThread;
+    CHECK(o.startTime >= lastStart[t]);
+    lastStart[t] = o.startTime;
+  }
+  CHECK(*values.begin() == 0 && *values.rbegin() == threads * perThread - 1);
+}
+
+// a thread alternating between two recorders keeps one ring in each
+void test_alternating(const std::string& pathA, const std::string& pathB) {
+  const int records = 200;
+  {
+    recorder a{pathA, "queue"}, b{pathB, "queue"};
+    for (int i = 0; i < records; ++i)
+      (i % 2 ? b : a).record(Method::ENQ, i, i % 2 ? b.now() : a.now());
+  }
+  // a ring per switch would take 2 MiB each
+  rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  CHECK(usage.ru_maxrss < 128 * 1024);
+
+  std::string type;
+  history_t<value_type> histA = read_back(pathA, type);
+  history_t<value_type> histB = read_back(pathB, type);
+  CHECK(type == "queue");
+  CHECK(histA.size() == records / 2 && histB.size() == records / 2);
+  for (size_t i = 0; i < histA.size(); ++i) {
+    CHECK(histA[i].value == static_cast<value_type>(2 * i));
+    CHECK(histB[i].value == static_cast<value_type>(2 * i + 1));
+  }
+}
+
+int main() {
+  std::filesystem::path dir = std::filesystem::temp_directory_path() /
+                              ("fastlin-recorder-test-" +
+                               std::to_string(getpid()));
+  std::filesystem::create_directories(dir);
+  test_alternating(dir / "a.bin", dir / "b.bin");
+  test_threads(dir / "threads.bin");
+  std::filesystem::remove_all(dir);
+  return 0;
+}
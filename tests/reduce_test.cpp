@@ -0,0 +1,67 @@
+#include <filesystem>
+
+#include "algo/priorityqueue_lin.h"
+#include "algo/queue_lin.h"
+#include "algo/stack_lin.h"
+#include "check.h"
+#include "history_reader.h"
+
+using namespace fastlin;
+
+typedef long long value_type;
+const value_type emptyVal = -1;
+
+// two values overlapping throughout, so nothing can be pruned
+void test_nothing_pruned() {
+  history_t<value_type> hist{{1, Method::PUSH, 1, 1, 4},
+                             {2, Method::PUSH, 2, 2, 5},
+                             {3, Method::POP, 2, 3, 7},
+                             {4, Method::POP, 1, 6, 8}};
+  reduce_history<value_type, stack::add_methods, stack::remove_methods>(hist);
+  CHECK(pruned_ops == 0);
+  CHECK(hist.size() == 4);
+  for (size_t i = 0; i < hist.size(); ++i) CHECK(hist[i].id == i + 1);
+  CHECK(hist[2].value == 2 && hist[2].startTime == 3);
+}
+
+// value 1 overlaps no other value and is pruned, the rest is renumbered
+void test_isolated_pruned() {
+  history_t<value_type> hist{{1, Method::PUSH, 1, 1, 2},
+                             {2, Method::POP, 1, 3, 4},
+                             {3, Method::PUSH, 2, 5, 8},
+                             {4, Method::PUSH, 3, 6, 9},
+                             {5, Method::POP, 3, 7, 11},
+                             {6, Method::POP, 2, 10, 12}};
+  reduce_history<value_type, stack::add_methods, stack::remove_methods>(hist);
+  CHECK(pruned_ops == 2);
+  CHECK(hist.size() == 4);
+  for (size_t i = 0; i < hist.size(); ++i) {
+    CHECK(hist[i].id == i + 1);
+    CHECK(hist[i].value != 1);
+    CHECK(hist[i].startTime >= 1 && hist[i].endTime <= 8);
+  }
+}
+
+// the shipped testcases, whose names tell their verdicts
+void test_testcases(const std::filesystem::path& dir) {
+  for (const auto& entry : std::filesystem::recursive_directory_iterator(dir)) {
+    if (!entry.is_regular_file()) continue;
+    std::string type = entry.path().parent_path().filename();
+    bool expected = entry.path().filename().string().starts_with("lin_");
+    history_t<value_type> hist =
+        history_reader<value_type>(entry.path()).get_hist();
+    if (type == "stack")
+      CHECK(stack::is_linearizable(hist, emptyVal) == expected);
+    else if (type == "queue")
+      CHECK(queue::is_linearizable(hist, emptyVal) == expected);
+    else if (type == "priorityqueue")
+      CHECK(priorityqueue::is_linearizable(hist, emptyVal) == expected);
+  }
+}
+
+int main(int argc, char* argv[]) {
+  test_nothing_pruned();
+  test_isolated_pruned();
+  if (argc > 1) test_testcases(argv[1]);
+  return 0;
+}
@@ -0,0 +1,142 @@
+#include <filesystem>
+#include <random>
+#include <set>
+
+#include "algo/counter_lin.h"
+#include "algo/priorityqueue_lin.h"
+#include "algo/queue_lin.h"
+#include "algo/set_lin.h"
+#include "algo/stack_lin.h"
+#include "check.h"
+#include "history_reader.h"
+#include "search.h"
+
+using namespace fastlin;
+
+typedef long long value_type;
+const value_type emptyVal = -1;
+
+bool standard(const std::string& type, history_t<value_type> hist) {
+#define SUPPORT_DS(TYPE) \
+  if (type == #TYPE) return TYPE::is_linearizable(hist, emptyVal);
+  SUPPORT_DS(set);
+  SUPPORT_DS(stack);
+  SUPPORT_DS(queue);
+  SUPPORT_DS(priorityqueue);
+  SUPPORT_DS(counter);
+#undef SUPPORT_DS
+  throw std::invalid_argument("Unknown data type");
+}
+
+bool agree(const std::string& type, const history_t<value_type>& hist) {
+  return search_linearization(type, hist, emptyVal) == standard(type, hist);
+}
+
+// the shipped testcases, whose names tell their verdicts
+void test_testcases(const std::filesystem::path& dir) {
+  for (const auto& entry : std::filesystem::recursive_directory_iterator(dir)) {
+    if (!entry.is_regular_file()) continue;
+    std::string type = entry.path().parent_path().filename();
+    bool expected = entry.path().filename().string().starts_with("lin_");
+    history_t<value_type> hist =
+        history_reader<value_type>(entry.path()).get_hist();
+    CHECK(search_linearization(type, hist, emptyVal) == expected);
+    CHECK(standard(type, hist) == expected);
+  }
+}
+
+/**
+ * A history of `ops` operations performed one after another on a sequential
+ * object, each stretched around its point of taking effect so that it
+ * overlaps a few neighbours, with the values of two removes or peeks swapped
+ * half of the time
+ */
+history_t<value_type> random_history(const std::string& type, size_t ops,
+                                     std::mt19937& rng) {
+  auto coin = [&](int n) {
+    return std::uniform_int_distribution(0, n - 1)(rng);
+  };
+  history_t<value_type> hist;
+  std::vector<value_type> values;  // stack, queue or priority queue order
+  std::set<value_type> present;    // set
+  value_type next = 0, count = 0;
+  for (size_t i = 0; i < ops; ++i) {
+    Method method;
+    value_type value = emptyVal;
+    bool add = coin(5) < 2 || (values.empty() && present.empty() && coin(2));
+    bool peek = !add && coin(4) == 0;
+    if (type == "counter") {
+      method = coin(3) ? Method::FETCH_ADD : Method::READ;
+      value = method == Method::FETCH_ADD ? count++ : count;
+    } else if (type == "set") {
+      if (add || present.empty()) {
+        method = peek ? Method::CONTAINS_FALSE : Method::INSERT;
+        value = next++;
+        if (!peek) present.insert(value);
+      } else {
+        auto iter = std::next(present.begin(), coin(present.size()));
+        value = *iter;
+        method = peek ? Method::CONTAINS_TRUE : Method::REMOVE;
+        if (!peek) present.erase(iter);
+      }
+    } else if (add) {
+      method = type == "stack" ? Method::PUSH
+               : type == "queue" ? Method::ENQ
+                                 : Method::INSERT;
+      value = next++;
+      values.push_back(value);
+      if (type == "priorityqueue")
+        std::sort(values.begin(), values.end(), std::greater<>());
+    } else {
+      method = peek ? Method::PEEK
+               : type == "stack" ? Method::POP
+               : type == "queue" ? Method::DEQ
+                                 : Method::POLL;
+      if (!values.empty()) {
+        bool back = type == "stack";
+        value = back ? values.back() : values.front();
+        if (!peek) values.erase(back ? values.end() - 1 : values.begin());
+      }
+    }
+    // distinct times, as the set engine lets operations meeting at a time
+    // overlap while the others order the response first
+    time_type point = 4 * i + 10, scale = 2 * ops;
+    hist.push_back({static_cast<id_type>(i + 1), method, value,
+                    (point - 1 - coin(8)) * scale + 2 * i,
+                    (point + 1 + coin(8)) * scale + 2 * i + 1});
+  }
+
+  if (coin(2)) {
+    std::vector<size_t> removes;
+    for (size_t i = 0; i < hist.size(); ++i)
+      if (hist[i].value != emptyVal && hist[i].method != Method::PUSH &&
+          hist[i].method != Method::ENQ && hist[i].method != Method::INSERT)
+        removes.push_back(i);
+    if (removes.size() > 1) {
+      size_t a = removes[coin(removes.size())];
+      size_t b = removes[coin(removes.size())];
+      std::swap(hist[a].value, hist[b].value);
+    }
+  }
+  return hist;
+}
+
+void test_random() {
+  std::mt19937 rng(12345);
+  for (std::string type : {"set", "stack", "queue", "priorityqueue", "counter"})
+    for (int round = 0; round < 500; ++round) {
+      history_t<value_type> hist = random_history(type, 1 + round % 24, rng);
+      if (!agree(type, hist)) {
+        for (const auto& o : hist)
+          std::cerr << methodtos(o.method) << " " << o.value << " "
+                    << o.startTime << " " << o.endTime << "\n";
+        CHECK(agree(type, hist));
+      }
+    }
+}
+
+int main(int argc, char* argv[]) {
+  if (argc > 1) test_testcases(argv[1]);
+  test_random();
+  return 0;
+}
@@ -0,0 +1,72 @@
+#include <filesystem>
+
+#include "check.h"
+#include "verdict_cache.h"
+
+using namespace fastlin;
+
+history_digest digest_of(uint64_t i) {
+  history_digest digest("stack", false);
+  digest.add(i);
+  return digest;
+}
+
+size_t entries(const std::filesystem::path& dir) {
+  size_t count = 0;
+  for (const auto& file : std::filesystem::directory_iterator(dir))
+    count += file.path().filename() != "stores";
+  return count;
+}
+
+// stored verdicts are found again, and eviction keeps the cache within
+// `max_entries` plus the stores between evictions
+void test_store_evict(const std::filesystem::path& dir) {
+  const size_t max_entries = 64, stores = 1000;
+  verdict_cache cache{dir, max_entries};
+  for (size_t i = 0; i < stores; ++i) {
+    cache.store(digest_of(i), {i % 2 == 0, 1, i, 0});
+    CHECK(entries(dir) <= max_entries + max_entries / 16);
+  }
+  CHECK(entries(dir) >= max_entries);
+
+  auto latest = cache.lookup(digest_of(stores - 1), stores - 1);
+  CHECK(latest && !latest->result && latest->operations == stores - 1);
+  CHECK(!cache.lookup(digest_of(stores - 1), stores));
+  CHECK(!cache.lookup(digest_of(0), 0));
+}
+
+// digest of a stack history pushing 1 and 2 and popping `a` and `b`
+history_digest digest_of_pops(long long a, long long b) {
+  history_t<long long> hist;
+  history_digest digest("stack", false);
+  auto sink = digest.into(hist);
+  sink.emplace_back(1, Method::PUSH, 1LL, 1, 2);
+  sink.emplace_back(2, Method::PUSH, 2LL, 3, 4);
+  sink.emplace_back(3, Method::POP, a, 5, 6);
+  sink.emplace_back(4, Method::POP, b, 7, 8);
+  return digest;
+}
+
+// histories differing only in an even number of sign bits are told apart
+void test_sign_bits(const std::filesystem::path& dir) {
+  const long long sign = std::numeric_limits<long long>::min();
+  history_digest a = digest_of_pops(2, 1);
+  history_digest b = digest_of_pops(2 ^ sign, 1 ^ sign);
+  CHECK(a.key() != b.key());
+  CHECK(a.key() != digest_of_pops(2 ^ sign, 1).key());
+
+  verdict_cache cache{dir, 64};
+  cache.store(a, {true, 1, 4, 0});
+  CHECK(cache.lookup(a, 4));
+  CHECK(!cache.lookup(b, 4));
+}
+
+int main() {
+  std::filesystem::path dir = std::filesystem::temp_directory_path() /
+                              ("fastlin-verdict-cache-test-" +
+                               std::to_string(getpid()));
+  test_store_evict(dir);
+  test_sign_bits(dir);
+  std::filesystem::remove_all(dir);
+  return 0;
+}